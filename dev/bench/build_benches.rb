@@ -0,0 +1,6 @@
+require 'mxx_ru/cpp'
+
+MxxRu::Cpp::composite_target {
+
+  required_prj "bench/image_route/prj.rb"
+}
@@ -0,0 +1,149 @@
+/*
+	Shrimp
+
+	Microbenchmark for matching of requests for images.
+
+	Compares the hand-written matcher with the way the express router
+	handled the image route: PCRE regex produced from
+	`/:path(.*)\.:ext(.{3,4})` and restinio::parse_query.
+*/
+
+#include <shrimp/image_route.hpp>
+
+#include <restinio/all.hpp>
+
+#include <pcre.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace
+{
+
+const std::vector< std::pair< std::string_view, std::string_view > > requests{
+	{ "/photos/2018/summer/beach.jpg", "op=resize&width=320" },
+	{ "/photos/2018/summer/beach.jpg", "op=resize&max=1024&target-format=webp" },
+	{ "/avatars/user-123456.png", "op=resize&width=64&height=64&v=17" },
+	{ "/logo.webp", "" },
+	{ "/cache/prewarm/12", "token=abc" }
+};
+
+constexpr std::size_t iterations = 1000000u;
+
+//! Prevents optimizing out results of the benchmarked code.
+volatile std::size_t sink{};
+
+template < typename Lambda >
+void
+measure( std::string_view name, Lambda && lambda )
+{
+	const auto started_at = std::chrono::steady_clock::now();
+
+	for( std::size_t i = 0u; i != iterations; ++i )
+		for( const auto & [path, query] : requests )
+			sink = sink + lambda( path, query );
+
+	const auto duration = std::chrono::steady_clock::now() - started_at;
+	const auto ns = std::chrono::duration_cast< std::chrono::nanoseconds >(
+			duration ).count();
+
+	std::cout << name << ": "
+		<< static_cast< double >( ns ) /
+				static_cast< double >( iterations * requests.size() )
+		<< " ns per request" << std::endl;
+}
+
+//! Regex which express router makes for the image route.
+class express_route_regex_t
+{
+public:
+	express_route_regex_t()
+	{
+		const char * error{};
+		int error_offset{};
+		m_regex = pcre_compile( R"(^\/(.*)\.(.{3,4})$)", 0,
+				&error, &error_offset, nullptr );
+		if( !m_regex )
+			throw std::runtime_error{ error };
+	}
+
+	~express_route_regex_t()
+	{
+		pcre_free( m_regex );
+	}
+
+	express_route_regex_t( const express_route_regex_t & ) = delete;
+	express_route_regex_t & operator=( const express_route_regex_t & ) = delete;
+
+	//! Get the extension as express router puts it to route params.
+	[[nodiscard]] std::optional< std::string >
+	match( std::string_view path ) const
+	{
+		// Max capture groups of http_req_router_t.
+		constexpr int max_groups = 5;
+		int ovector[ ( max_groups + 1 ) * 3 ];
+		const int rc = pcre_exec( m_regex, nullptr,
+				path.data(), static_cast< int >( path.size() ),
+				0, 0, ovector, ( max_groups + 1 ) * 3 );
+		if( rc < 3 )
+			return std::nullopt;
+
+		// Route params are copied to a buffer by the router.
+		std::string params_buffer{ path };
+		return params_buffer.substr(
+				static_cast< std::size_t >( ovector[ 4 ] ),
+				static_cast< std::size_t >( ovector[ 5 ] - ovector[ 4 ] ) );
+	}
+
+private:
+	pcre * m_regex{};
+};
+
+} /* namespace anonymous */
+
+int
+main()
+{
+	const express_route_regex_t regex;
+
+	measure( "express route + parse_query",
+		[&regex]( std::string_view path, std::string_view query ) {
+			const auto ext = regex.match( path );
+			if( !ext )
+				return std::size_t{};
+
+			const auto qp = restinio::parse_query( query );
+			const auto width = restinio::opt_value< std::uint32_t >( qp, "width" );
+			const std::string image_path{ path };
+
+			return ext->size() + qp.size() + ( width ? *width : 0u ) +
+					image_path.size();
+		} );
+
+	measure( "try_match_image_route + parse_image_query",
+		[]( std::string_view path, std::string_view query ) {
+			const auto route = shrimp::try_match_image_route( path );
+			if( !route )
+				return std::size_t{};
+
+			const auto qp = shrimp::parse_image_query( query, "v"sv );
+			if( !qp )
+				return std::size_t{};
+
+			const std::string image_path{ path };
+
+			return route->m_ext.size() + qp->m_params_count +
+					( qp->m_width ? qp->m_width->size() : 0u ) +
+					image_path.size();
+		} );
+
+	return 0;
+}
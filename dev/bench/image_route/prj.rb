@@ -0,0 +1,13 @@
+require 'mxx_ru/cpp'
+
+require 'shrimp/magickpp_helper.rb'
+
+MxxRu::Cpp::exe_target {
+
+	required_prj 'shrimp/prj.rb'
+	ShrimpMagickppHelper.attach_imagemagickpp( self )
+
+	target( "_bench.image_route" )
+
+	cpp_source( "main.cpp" )
+}
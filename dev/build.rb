@@ -30,6 +30,7 @@ MxxRu::Cpp::composite_target( MxxRu::BUILD_ROOT ) {
 	end
 
 	required_prj 'test/build_tests.rb'
+	required_prj 'bench/build_benches.rb'
 	required_prj 'shrimp/app/prj.rb'
 }
 
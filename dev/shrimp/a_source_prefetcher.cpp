@@ -0,0 +1,92 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief An agent for reading source images in advance.
+ */
+
+#include <shrimp/a_source_prefetcher.hpp>
+
+#include <shrimp/utils.hpp>
+
+namespace shrimp {
+
+//
+// a_source_prefetcher_t
+//
+a_source_prefetcher_t::a_source_prefetcher_t(
+	context_t ctx,
+	std::shared_ptr<spdlog::logger> logger,
+	source_files_shared_ptr_t source_files )
+	: so_5::agent_t{ std::move(ctx) }
+	, m_logger{ std::move(logger) }
+	, m_source_files{ std::move(source_files) }
+{}
+
+void
+a_source_prefetcher_t::so_define_agent()
+{
+	so_subscribe_self()
+			.event(
+				&a_source_prefetcher_t::on_prefetch_request,
+				so_5::thread_safe )
+			.event(
+				&a_source_prefetcher_t::on_image_info_read_request,
+				so_5::thread_safe );
+}
+
+void
+a_source_prefetcher_t::on_prefetch_request(
+	mhood_t<prefetch_request_t> cmd ) const
+{
+	source_content_shared_ptr_t source;
+	try
+	{
+		const auto duration = measure_duration( [&] {
+				source = m_source_files->read( cmd->m_path );
+			} );
+
+		m_logger->trace( "source prefetched; path={}, size={}, time={}ms",
+				cmd->m_path,
+				source->size(),
+				std::chrono::duration_cast<std::chrono::milliseconds>(
+						duration).count() );
+	}
+	catch( const std::exception & x )
+	{
+		// The failure will be detected and reported by a transformer.
+		m_logger->debug( "source prefetch failed; path={}, reason={}",
+				cmd->m_path,
+				x.what() );
+		source.reset();
+	}
+
+	so_5::send< a_transform_manager_t::prefetch_result_t >(
+			cmd->m_reply_to,
+			cmd->m_path,
+			std::move(source) );
+}
+
+void
+a_source_prefetcher_t::on_image_info_read_request(
+	mhood_t<image_info_read_request_t> cmd ) const
+{
+	// The request isn't used by anyone else until it is sent back.
+	auto & request = *(cmd->m_request);
+
+	request.m_stat = m_source_files->stat( request.m_path );
+	if( request.m_stat )
+		request.m_info = m_source_files->read_image_info( request.m_path );
+
+	m_logger->trace( "source image info read; path={}, found={}",
+			request.m_path,
+			request.m_info.has_value() );
+
+	so_5::send< a_transform_manager_t::image_info_read_t >(
+			cmd->m_reply_to,
+			cmd->m_request );
+}
+
+} /* namespace shrimp */
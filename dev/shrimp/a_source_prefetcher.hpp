@@ -0,0 +1,99 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief An agent for reading source images in advance.
+ */
+
+#pragma once
+
+#include <shrimp/a_transform_manager.hpp>
+#include <shrimp/source_files.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace shrimp {
+
+//
+// a_source_prefetcher_t
+//
+/*!
+ * \brief An agent which reads source images before they will be
+ * transformed.
+ *
+ * This agent receives prefetch_request_t and reads the whole content
+ * of the source file into memory. So the content is in memory
+ * when a transformer starts decoding of the image. The result is sent back
+ * as a_transform_manager_t::prefetch_result_t message.
+ *
+ * This agent also reads headers of source images for requests for
+ * information about images. Such a request is completed and sent back
+ * as a_transform_manager_t::image_info_read_t message.
+ *
+ * \note This agent is intended to be bound to adv_thread_pool dispatcher.
+ * Its event handler is thread-safe, so several source images can be read
+ * in parallel.
+ */
+class a_source_prefetcher_t final : public so_5::agent_t
+{
+public:
+	//! A request for reading a source image.
+	struct prefetch_request_t final : public so_5::message_t
+	{
+		//! Path to source image.
+		const std::string m_path;
+		//! Mbox for the result of the reading.
+		const so_5::mbox_t m_reply_to;
+
+		prefetch_request_t(
+			std::string path,
+			so_5::mbox_t reply_to )
+			: m_path{ std::move(path) }
+			, m_reply_to{ std::move(reply_to) }
+		{}
+	};
+
+	//! A request for reading the header of a source image.
+	struct image_info_read_request_t final : public so_5::message_t
+	{
+		//! Request for information to be completed.
+		const sobj_shptr_t<
+				a_transform_manager_t::image_info_request_t > m_request;
+		//! Mbox for the completed request.
+		const so_5::mbox_t m_reply_to;
+
+		image_info_read_request_t(
+			sobj_shptr_t< a_transform_manager_t::image_info_request_t > request,
+			so_5::mbox_t reply_to )
+			: m_request{ std::move(request) }
+			, m_reply_to{ std::move(reply_to) }
+		{}
+	};
+
+	a_source_prefetcher_t(
+		context_t ctx,
+		std::shared_ptr<spdlog::logger> logger,
+		source_files_shared_ptr_t source_files );
+
+	virtual void
+	so_define_agent() override;
+
+private:
+	//! Personal logger for this agent.
+	const std::shared_ptr<spdlog::logger> m_logger;
+
+	//! Access to source images.
+	const source_files_shared_ptr_t m_source_files;
+
+	void
+	on_prefetch_request(
+		mhood_t<prefetch_request_t> cmd ) const;
+
+	void
+	on_image_info_read_request(
+		mhood_t<image_info_read_request_t> cmd ) const;
+};
+
+} /* namespace shrimp */
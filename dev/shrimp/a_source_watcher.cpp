@@ -0,0 +1,304 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief An agent for watching the storage root directory.
+ */
+
+#include <shrimp/a_source_watcher.hpp>
+
+#include <shrimp/a_transform_manager.hpp>
+#include <shrimp/common_types.hpp>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace shrimp {
+
+namespace /* anonymous */
+{
+
+namespace fs = std::filesystem;
+
+//! Events to be watched for every directory.
+constexpr std::uint32_t watch_mask =
+		IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+		IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+[[nodiscard]] std::string
+join_relative_path( const std::string & dir, std::string_view name )
+{
+	std::string result;
+	result.reserve( dir.size() + 1u + name.size() );
+	if( !dir.empty() )
+	{
+		result += dir;
+		result += '/';
+	}
+	result.append( name.data(), name.size() );
+
+	return result;
+}
+
+[[nodiscard]] bool
+is_inside_directory( const std::string & path, const std::string & dir )
+{
+	return path.size() > dir.size() &&
+			'/' == path[ dir.size() ] &&
+			0 == path.compare( 0, dir.size(), dir );
+}
+
+} /* anonymous namespace */
+
+//
+// a_source_watcher_t
+//
+a_source_watcher_t::a_source_watcher_t(
+	context_t ctx,
+	std::shared_ptr<spdlog::logger> logger,
+	storage_params_t cfg,
+	std::shared_ptr<source_index_t> index,
+	source_files_shared_ptr_t source_files,
+	so_5::mbox_t transform_manager )
+	: so_5::agent_t{ std::move(ctx) }
+	, m_logger{ std::move(logger) }
+	, m_cfg{ std::move(cfg) }
+	, m_index{ std::move(index) }
+	, m_source_files{ std::move(source_files) }
+	, m_transform_manager{ std::move(transform_manager) }
+	, m_inotify_fd{ ::inotify_init1( IN_NONBLOCK | IN_CLOEXEC ) }
+{}
+
+void
+a_source_watcher_t::so_define_agent()
+{
+	so_subscribe_self().event( &a_source_watcher_t::on_check_events );
+}
+
+void
+a_source_watcher_t::so_evt_start()
+{
+	if( !m_inotify_fd )
+		return turn_index_off( std::strerror( errno ) );
+
+	rescan();
+
+	m_check_events_timer = so_5::send_periodic<check_events_t>(
+			*this,
+			check_events_period,
+			check_events_period );
+}
+
+void
+a_source_watcher_t::on_check_events( mhood_t<check_events_t> )
+{
+	alignas(inotify_event) std::array<char, 64u * 1024u> buffer;
+
+	while( m_inotify_fd )
+	{
+		const auto bytes = ::read(
+				m_inotify_fd.get(), buffer.data(), buffer.size() );
+		if( bytes <= 0 )
+			// There is no more events (or an error occured, it will
+			// be detected on the next attempt).
+			break;
+
+		for( const char * p = buffer.data(); p < buffer.data() + bytes; )
+		{
+			const auto * event = reinterpret_cast< const inotify_event * >( p );
+			p += sizeof(inotify_event) + event->len;
+
+			if( IN_Q_OVERFLOW & event->mask )
+			{
+				m_logger->warn( "inotify queue overflow, rescan images directory" );
+
+				// Some changes are lost, so anything could be changed.
+				report_change( std::string{}, true );
+				return rescan();
+			}
+
+			handle_event(
+					event->wd,
+					event->mask,
+					event->len ? std::string_view{ event->name } : std::string_view{} );
+		}
+	}
+}
+
+void
+a_source_watcher_t::rescan()
+{
+	for( const auto & [wd, path] : m_watched_dirs )
+		::inotify_rm_watch( m_inotify_fd.get(), wd );
+	m_watched_dirs.clear();
+
+	try
+	{
+		std::set< std::string, std::less<> > paths;
+		watch_directory( std::string{}, [&paths]( std::string path ) {
+				paths.insert( std::move(path) );
+			} );
+
+		m_logger->info( "images directory indexed; files={}, directories={}",
+				paths.size(),
+				m_watched_dirs.size() );
+
+		m_index->reset( std::move(paths) );
+	}
+	catch( const std::exception & x )
+	{
+		turn_index_off( x.what() );
+	}
+}
+
+template< typename File_Handler >
+void
+a_source_watcher_t::watch_directory(
+	const std::string & relative_dir,
+	File_Handler && file_handler )
+{
+	const auto full_path = relative_dir.empty() ?
+			fs::path{ m_cfg.m_root_dir } :
+			fs::path{ m_cfg.m_root_dir } / relative_dir;
+
+	const int wd = ::inotify_add_watch(
+			m_inotify_fd.get(), full_path.c_str(), watch_mask );
+	if( wd < 0 )
+		throw exception_t{ "unable to watch directory {}: {}",
+				full_path.string(),
+				std::strerror( errno ) };
+	m_watched_dirs[ wd ] = relative_dir;
+
+	for( const auto & entry : fs::directory_iterator{ full_path } )
+	{
+		auto path = join_relative_path(
+				relative_dir,
+				entry.path().filename().string() );
+
+		if( !entry.is_symlink() && entry.is_directory() )
+			watch_directory( path, file_handler );
+		else if( entry.is_regular_file() )
+			file_handler( std::move(path) );
+	}
+}
+
+void
+a_source_watcher_t::unwatch_directory( const std::string & relative_dir )
+{
+	for( auto it = m_watched_dirs.begin(); it != m_watched_dirs.end(); )
+	{
+		if( it->second == relative_dir ||
+				is_inside_directory( it->second, relative_dir ) )
+		{
+			::inotify_rm_watch( m_inotify_fd.get(), it->first );
+			it = m_watched_dirs.erase( it );
+		}
+		else
+			++it;
+	}
+}
+
+void
+a_source_watcher_t::handle_event(
+	int wd,
+	std::uint32_t mask,
+	std::string_view name )
+{
+	if( IN_IGNORED & mask )
+	{
+		// Directory was removed or isn't watched anymore.
+		m_watched_dirs.erase( wd );
+		return;
+	}
+
+	const auto dir_it = m_watched_dirs.find( wd );
+	if( dir_it == m_watched_dirs.end() || name.empty() )
+		return;
+
+	auto path = join_relative_path( dir_it->second, name );
+
+	m_logger->trace( "images directory event; path={}, mask={:#x}",
+			path, mask );
+
+	report_change( path, 0 != ( IN_ISDIR & mask ) );
+
+	if( IN_ISDIR & mask )
+	{
+		if( (IN_CREATE | IN_MOVED_TO) & mask )
+		{
+			try
+			{
+				watch_directory( path, [this]( std::string file ) {
+						m_index->insert( std::move(file) );
+					} );
+			}
+			catch( const std::exception & x )
+			{
+				// Directory could be removed already.
+				m_logger->warn( "unable to index new directory; path={}, "
+						"reason={}",
+						path,
+						x.what() );
+			}
+		}
+		else if( (IN_DELETE | IN_MOVED_FROM) & mask )
+		{
+			unwatch_directory( path );
+			m_index->erase_directory( path );
+		}
+	}
+	else
+	{
+		if( (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO) & mask )
+		{
+			std::error_code ec;
+			if( fs::is_regular_file( fs::path{ m_cfg.m_root_dir } / path, ec ) )
+				m_index->insert( std::move(path) );
+		}
+		else if( (IN_DELETE | IN_MOVED_FROM) & mask )
+			m_index->erase( path );
+	}
+}
+
+void
+a_source_watcher_t::report_change(
+	const std::string & relative_path,
+	bool is_directory )
+{
+	if( is_directory )
+		m_source_files->forget_directory( relative_path );
+	else
+		m_source_files->forget( relative_path );
+
+	// Transform manager uses paths from URLs.
+	so_5::send< a_transform_manager_t::source_changed_t >(
+			m_transform_manager,
+			"/" + relative_path,
+			is_directory );
+}
+
+void
+a_source_watcher_t::turn_index_off( std::string_view reason )
+{
+	m_logger->error( "images directory can't be watched, index of source "
+			"images is turned off; reason={}",
+			reason );
+
+	m_index->turn_off();
+
+	for( const auto & [wd, path] : m_watched_dirs )
+		::inotify_rm_watch( m_inotify_fd.get(), wd );
+	m_watched_dirs.clear();
+
+	m_check_events_timer.release();
+	m_inotify_fd = unique_fd_t{};
+}
+
+} /* namespace shrimp */
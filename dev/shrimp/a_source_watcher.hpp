@@ -0,0 +1,134 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief An agent for watching the storage root directory.
+ */
+
+#pragma once
+
+#include <shrimp/app_params.hpp>
+#include <shrimp/source_files.hpp>
+#include <shrimp/source_index.hpp>
+
+#include <so_5/all.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace shrimp {
+
+//
+// a_source_watcher_t
+//
+/*!
+ * \brief An agent which watches changes inside the storage root directory.
+ *
+ * This agent uses inotify for tracking of created, deleted and moved
+ * files in the whole tree of the root directory. The list of existing
+ * files is kept in source_index_t.
+ *
+ * Every change of a file (or a directory) is reported to the transform
+ * manager, so the manager can drop images made from outdated sources.
+ * Opened descriptors for changed files are removed from source_files_t.
+ *
+ * Events are read periodically from non-blocking inotify descriptor.
+ *
+ * \note Symbolic links to directories are not followed.
+ */
+class a_source_watcher_t final : public so_5::agent_t
+{
+public:
+	a_source_watcher_t(
+		context_t ctx,
+		std::shared_ptr<spdlog::logger> logger,
+		storage_params_t cfg,
+		std::shared_ptr<source_index_t> index,
+		source_files_shared_ptr_t source_files,
+		so_5::mbox_t transform_manager );
+
+	virtual void
+	so_define_agent() override;
+
+	virtual void
+	so_evt_start() override;
+
+private:
+	//! A special signal to read pending inotify events.
+	struct check_events_t final : public so_5::signal_t {};
+
+	//! Interval for reading inotify events.
+	static constexpr std::chrono::milliseconds check_events_period{ 100 };
+
+	//! Personal logger for this agent.
+	const std::shared_ptr<spdlog::logger> m_logger;
+
+	//! Configuration for agent.
+	const storage_params_t m_cfg;
+
+	//! Index of existing source images.
+	const std::shared_ptr<source_index_t> m_index;
+
+	//! Access layer for source images.
+	const source_files_shared_ptr_t m_source_files;
+
+	//! Mbox of transform manager for notifications about changes.
+	const so_5::mbox_t m_transform_manager;
+
+	//! Inotify descriptor.
+	unique_fd_t m_inotify_fd;
+
+	//! Relative paths of watched directories.
+	std::map<int, std::string> m_watched_dirs;
+
+	//! Timer for reading inotify events.
+	so_5::timer_id_t m_check_events_timer;
+
+	void
+	on_check_events( mhood_t<check_events_t> );
+
+	//! Watch the whole tree and rebuild the index from scratch.
+	void
+	rescan();
+
+	//! Add watches for a directory and all its subdirectories.
+	/*!
+	 * Relative paths of all files found are passed to \a file_handler.
+	 */
+	template< typename File_Handler >
+	void
+	watch_directory(
+		const std::string & relative_dir,
+		File_Handler && file_handler );
+
+	//! Remove watches for a directory and all its subdirectories.
+	void
+	unwatch_directory( const std::string & relative_dir );
+
+	//! Handle one event from inotify.
+	void
+	handle_event(
+		int wd,
+		std::uint32_t mask,
+		std::string_view name );
+
+	//! Notify about a change of a file or a directory.
+	/*!
+	 * Empty \a relative_path with \a is_directory means the whole tree.
+	 */
+	void
+	report_change(
+		const std::string & relative_path,
+		bool is_directory );
+
+	//! Stop maintaining of the index because of an error.
+	void
+	turn_index_off( std::string_view reason );
+};
+
+} /* namespace shrimp */
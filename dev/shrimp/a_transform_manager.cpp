@@ -7,24 +7,192 @@
  * \brief A manager for transform operations.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
+
+#include <fnmatch.h>
 
 #include <shrimp/a_transform_manager.hpp>
 
 #include <shrimp/response_common.hpp>
 #include <shrimp/utils.hpp>
 #include <shrimp/a_transformer.hpp>
+#include <shrimp/a_source_prefetcher.hpp>
+
+#include <restinio/utils/base64.hpp>
 
 namespace shrimp {
 
+namespace /* anonymous */
+{
+
+//! Make the response for a request on the context of its server.
+/*!
+ * Assembling and sending of responses doesn't block the manager's
+ * thread even if there are many requests for the same image.
+ * The request object (with its slot in the limit of active requests)
+ * lives until the response is made.
+ */
+template < typename Request, typename Response_Maker >
+void
+make_response_on_io_context(
+	sobj_shptr_t< Request > request,
+	Response_Maker && response_maker )
+{
+	if( auto * io_context = request->m_io_context )
+		restinio::asio_ns::post( *io_context,
+				[request = std::move(request),
+					response_maker = std::forward<Response_Maker>(response_maker)
+				]() mutable {
+					response_maker( *request );
+				} );
+	else
+		response_maker( *request );
+}
+
+//! Select entries of a cache by a delete cache request.
+/*!
+ * \note Request with selector_t::all must be handled by the caller.
+ */
+template < typename Cache, typename Path_Of >
+[[nodiscard]] auto
+select_for_deletion(
+	Cache & cache,
+	const a_transform_manager_t::delete_cache_request_t & request,
+	Path_Of && path_of )
+{
+	using selector_t = a_transform_manager_t::delete_cache_request_t::selector_t;
+
+	// Keys are ordered by paths first, so all entries for the selected
+	// paths are in a contiguous range. The range starts from the
+	// literal part of the pattern.
+	const std::string_view pattern{ request.m_pattern };
+	const auto prefix = selector_t::glob == request.m_selector ?
+			pattern.substr( 0, pattern.find_first_of( "*?[\\" ) ) :
+			pattern;
+
+	const auto in_range = [&]( const auto & k ) {
+		const std::string_view path{ path_of( k ) };
+		return selector_t::path == request.m_selector ?
+				path == prefix : starts_with( path, prefix );
+	};
+
+	auto selected = cache.select_from( prefix, in_range );
+	if( selector_t::glob == request.m_selector )
+		selected.erase(
+				std::remove_if( selected.begin(), selected.end(),
+					[&]( const auto & atoken ) {
+						const std::string path{ path_of( atoken.key() ) };
+						return 0 != ::fnmatch(
+								request.m_pattern.c_str(), path.c_str(), 0 );
+					} ),
+				selected.end() );
+
+	return selected;
+}
+
+//! Make a data URI from an image.
+[[nodiscard]] std::string
+make_data_uri( const datasizable_blob_t & blob, image_format_t format )
+{
+	return fmt::format( "data:image/{};base64,{}",
+			image_format_t::jpeg == format ?
+					std::string_view{ "jpeg" } :
+					image_format_to_extension( format ),
+			restinio::utils::base64::encode( std::string_view{
+					static_cast< const char * >( blob.data() ), blob.size() } ) );
+}
+
+//! Description of an image from the cache for info about its source.
+struct cached_rendition_t
+{
+	transform::resize_request_key_t m_key;
+	std::size_t m_size;
+	bool m_pinned;
+};
+
+//! Make JSON with information about a source image.
+[[nodiscard]] std::string
+make_image_info_json(
+	const a_transform_manager_t::image_info_request_t & request,
+	const std::vector< cached_rendition_t > & renditions )
+{
+	using mode_t = transform::resize_params_t::mode_t;
+
+	const auto mode_name = []( mode_t mode ) {
+		switch( mode )
+		{
+			case mode_t::width: return "width";
+			case mode_t::height: return "height";
+			case mode_t::longest: return "max";
+			case mode_t::keep_original: break;
+		}
+		return "original";
+	};
+
+	std::string result{ "{\"path\":" };
+	append_json_string( result, request.m_path );
+	result += fmt::format( ",\"format\":\"{}\",\"width\":{},\"height\":{},"
+			"\"size\":{},\"mtime\":{},\"renditions\":[",
+			image_format_to_extension( request.m_info->m_format ),
+			request.m_info->m_width,
+			request.m_info->m_height,
+			request.m_stat->m_size,
+			std::chrono::duration_cast< std::chrono::seconds >(
+					request.m_stat->m_last_modified_at.time_since_epoch() )
+					.count() );
+
+	for( const auto & r : renditions )
+	{
+		if( &r != &renditions.front() )
+			result += ',';
+
+		const auto params = r.m_key.params();
+		result += fmt::format( "{{\"format\":\"{}\",\"mode\":\"{}\"",
+				image_format_to_extension( r.m_key.format() ),
+				mode_name( params.mode() ) );
+		if( mode_t::keep_original != params.mode() )
+			result += fmt::format( ",\"value\":{}", params.value() );
+		result += fmt::format( ",\"quality\":{},\"size\":{},\"pinned\":{}}}",
+				r.m_key.quality(),
+				r.m_size,
+				r.m_pinned );
+	}
+
+	result += "]}";
+
+	return result;
+}
+
+} /* anonymous namespace */
+
+//
+// a_transform_manager_t::resize_request_t
+//
+
+[[nodiscard]] restinio::connection_id_t
+a_transform_manager_t::resize_request_t::connection_id() const
+{
+	return m_batch ?
+			m_batch->m_http_req->connection_id() :
+			m_http_req->connection_id();
+}
+
 //
 // a_transform_manager_t
 //
 a_transform_manager_t::a_transform_manager_t(
 	context_t ctx,
-	std::shared_ptr<spdlog::logger> logger )
+	std::shared_ptr<spdlog::logger> logger,
+	transform_manager_params_t params,
+	transform_params_t transform_params,
+	source_files_shared_ptr_t source_files )
 	: so_5::agent_t{ std::move(ctx) }
 	, m_logger{ std::move(logger) }
+	, m_params{ std::move(params) }
+	, m_transform_params{ std::move(transform_params) }
+	, m_source_files{ std::move(source_files) }
 {}
 
 void
@@ -32,9 +200,17 @@ a_transform_manager_t::so_define_agent()
 {
 	so_subscribe_self()
 			.event( &a_transform_manager_t::on_resize_request )
+			.event( &a_transform_manager_t::on_rendition_batch_request )
+			.event( &a_transform_manager_t::on_image_info_request )
+			.event( &a_transform_manager_t::on_placeholder_request )
 			.event( &a_transform_manager_t::on_resize_result )
+			.event( &a_transform_manager_t::on_prefetch_result )
+			.event( &a_transform_manager_t::on_image_info_read )
+			.event( &a_transform_manager_t::on_source_changed )
 			.event( &a_transform_manager_t::on_delete_cache_request )
-			.event( &a_transform_manager_t::on_negative_delete_cache_response )
+			.event( &a_transform_manager_t::on_prewarm_request )
+			.event( &a_transform_manager_t::on_prewarm_status_request )
+			.event( &a_transform_manager_t::on_negative_admin_response )
 			.event( &a_transform_manager_t::on_clear_cache )
 			.event( &a_transform_manager_t::on_check_pending_requests );
 }
@@ -60,30 +236,377 @@ void
 a_transform_manager_t::add_worker( so_5::mbox_t worker )
 {
 	m_free_workers.push( std::move(worker) );
+	++m_workers_count;
+}
+
+void
+a_transform_manager_t::set_prefetcher( so_5::mbox_t prefetcher )
+{
+	m_prefetcher = std::move(prefetcher);
+}
+
+void
+a_transform_manager_t::set_source_reader( so_5::mbox_t source_reader )
+{
+	m_source_reader = std::move(source_reader);
 }
 
 void
 a_transform_manager_t::on_resize_request(
 	mutable_mhood_t<resize_request_t> cmd )
 {
+	m_last_client_request_at = std::chrono::steady_clock::now();
+
+	if( canonicalize_request( *cmd ) )
+	{
+		m_logger->trace( "source image is sent as is; path={}, "
+				"connection_id={}",
+				cmd->m_image,
+				cmd->m_http_req->connection_id() );
+
+		// The file is opened on the context of the server.
+		make_response_on_io_context( cmd.make_reference(),
+				[source_files = m_source_files]( resize_request_t & rq ) {
+					static_cast< void >( serve_as_regular_file(
+							*source_files,
+							std::move(rq.m_http_req),
+							rq.m_target_format,
+							std::move(rq.m_response_headers) ) );
+				} );
+		return;
+	}
+
 	transform::resize_request_key_t request_key{
 			cmd->m_image,
 			cmd->m_target_format,
-			cmd->m_params };
+			cmd->m_params,
+			cmd->m_quality };
 
 	m_logger->trace( "request received; request_key={}, connection_id={}",
 			request_key,
 			cmd->m_http_req->connection_id() );
 
-	auto atoken = m_transformed_cache.lookup( request_key );
-	if( atoken )
+	handle_resize_request( std::move(request_key), cmd.make_reference() );
+}
+
+[[nodiscard]] std::optional< source_image_info_t >
+a_transform_manager_t::known_source_info( const std::string & path )
+{
+	auto atoken = m_source_infos.lookup( path );
+	if( !atoken )
+		return std::nullopt;
+
+	m_source_infos.update_access_time( *atoken );
+	return atoken->value();
+}
+
+[[nodiscard]] transform::resize_params_t
+a_transform_manager_t::make_canonical_params(
+	const std::optional< source_image_info_t > & info,
+	const transform::resize_params_t & params,
+	bool quantize ) const
+{
+	const auto original_size = info ?
+			std::make_optional( Magick::Geometry{
+					info->m_width, info->m_height } ) :
+			std::nullopt;
+
+	// The size is rounded up to the ladder before the canonicalization,
+	// otherwise the rounded size could be a non-canonical one.
+	auto result = quantize ?
+			transform::quantize_resize_params(
+					original_size,
+					params,
+					m_transform_params.m_size_step_percent ) :
+			params;
+
+	// A request which doesn't change the size uses the same key as
+	// the request without a size.
+	if( original_size )
+		result = transform::canonicalize_resize_params(
+				*original_size,
+				result,
+				!m_transform_params.m_no_upscale );
+
+	return result;
+}
+
+[[nodiscard]] transform::resize_request_key_t
+a_transform_manager_t::make_canonical_key( const requested_image_t & image )
+{
+	std::string path{ image.m_key.path() };
+	const auto params = make_canonical_params(
+			known_source_info( path ),
+			image.m_key.params(),
+			image.m_quantize );
+
+	return transform::resize_request_key_t{
+			std::move(path),
+			image.m_key.format(),
+			params,
+			image.m_key.quality() };
+}
+
+[[nodiscard]] bool
+a_transform_manager_t::canonicalize_request( resize_request_t & request )
+{
+	using mode_t = transform::resize_params_t::mode_t;
+
+	const auto info = known_source_info( request.m_image );
+
+	const auto requested_params = request.m_params;
+	request.m_params = make_canonical_params(
+			info, request.m_params, request.m_quantize );
+
+	// The source file can be sent as is if the image isn't changed.
+	if( info && mode_t::keep_original == request.m_params.mode() &&
+			info->m_format == request.m_target_format &&
+			0u == request.m_quality &&
+			!request.m_batch )
+		return true;
+
+	// The client must know the actual size if it differs from
+	// the requested one.
+	if( mode_t::keep_original != request.m_params.mode() &&
+			request.m_params.value() != requested_params.value() )
+	{
+		++m_quantized_requests;
+		if( !request.m_batch )
+			request.m_response_headers.emplace_back(
+					http_header::shrimp_actual_size_hf(),
+					std::to_string( request.m_params.value() ) );
+	}
+
+	return false;
+}
+
+void
+a_transform_manager_t::store_source_info(
+	std::string path,
+	const source_image_info_t & info )
+{
+	// The container ignores values for already known keys.
+	if( auto atoken = m_source_infos.lookup( path ) )
+		m_source_infos.erase( *atoken );
+
+	m_source_infos.insert( std::move(path), source_image_info_t{ info } );
+
+	while( max_source_infos < m_source_infos.size() )
+		m_source_infos.erase( m_source_infos.oldest().value() );
+}
+
+void
+a_transform_manager_t::on_rendition_batch_request(
+	mutable_mhood_t<rendition_batch_request_t> cmd )
+{
+	m_logger->debug( "rendition batch received; connection_id={}, images={}",
+			cmd->m_http_req->connection_id(),
+			cmd->m_items.size() );
+
+	m_last_client_request_at = std::chrono::steady_clock::now();
+
+	auto batch = std::make_shared< rendition_batch_t >( rendition_batch_t{
+			std::move(cmd->m_http_req),
+			renditions_t{},
+			cmd->m_items.size(),
+			cmd->m_io_context } );
+
+	batch->m_renditions.reserve( cmd->m_items.size() );
+	for( const auto & item : cmd->m_items )
+		batch->m_renditions.push_back( rendition_t{
+				item.m_url, item.m_image.m_key.format(), 0u, {} } );
+
+	// Every image is handled as a usual request. The order of the response
+	// is kept by indexes of images.
+	for( std::size_t index = 0u; index != cmd->m_items.size(); ++index )
+	{
+		auto & item = cmd->m_items[ index ];
+		const auto & key = item.m_image.m_key;
+
+		sobj_shptr_t<resize_request_t> request{ new resize_request_t{
+				restinio::request_handle_t{},
+				std::string{ key.path() },
+				key.format(),
+				key.params(),
+				key.quality(),
+				item.m_image.m_pinned,
+				item.m_image.m_quantize,
+				header_fields_list_t{},
+				std::move(item.m_active_request) } };
+		request->m_batch = batch;
+		request->m_batch_item = index;
+
+		if( item.m_missing )
+		{
+			complete_batch_item( *request, 404u );
+			continue;
+		}
+
+		static_cast< void >( canonicalize_request( *request ) );
+
+		transform::resize_request_key_t request_key{
+				request->m_image,
+				request->m_target_format,
+				request->m_params,
+				request->m_quality };
+
+		handle_resize_request( std::move(request_key), std::move(request) );
+	}
+}
+
+void
+a_transform_manager_t::on_image_info_request(
+	mutable_mhood_t<image_info_request_t> cmd )
+{
+	m_logger->trace( "image info request received; path={}, connection_id={}",
+			cmd->m_path,
+			cmd->m_http_req->connection_id() );
+
+	// The header of the image is read on the thread of the source reader
+	// because the reading can block.
+	so_5::send< a_source_prefetcher_t::image_info_read_request_t >(
+			m_source_reader,
+			cmd.make_reference(),
+			so_direct_mbox() );
+}
+
+void
+a_transform_manager_t::on_image_info_read(
+	mhood_t<image_info_read_t> cmd )
+{
+	auto request = cmd->m_request;
+
+	if( !request->m_info )
+	{
+		m_logger->trace( "source image info not read; path={}, "
+				"connection_id={}",
+				request->m_path,
+				request->m_http_req->connection_id() );
+
+		make_response_on_io_context( std::move(request),
+				[]( image_info_request_t & rq ) {
+					do_404_response( std::move(rq.m_http_req) );
+				} );
+		return;
+	}
+
+	store_source_info( request->m_path, *request->m_info );
+
+	const std::string_view path{ request->m_path };
+	const auto same_path = [path]( const transform::resize_request_key_t & k ) {
+		return k.path() == path;
+	};
+
+	std::vector< cached_rendition_t > renditions;
+	for( auto * cache : { &m_pinned_cache, &m_transformed_cache } )
+		for( const auto & atoken : cache->m_images.select_from( path, same_path ) )
+			renditions.push_back( cached_rendition_t{
+					atoken.key(),
+					atoken.value()->size(),
+					cache == &m_pinned_cache } );
+
+	// JSON is made on the context of the server.
+	make_response_on_io_context( std::move(request),
+			[renditions = std::move(renditions)]( image_info_request_t & rq ) {
+				do_200_json_response(
+						std::move(rq.m_http_req),
+						make_image_info_json( rq, renditions ) );
+			} );
+}
+
+void
+a_transform_manager_t::on_placeholder_request(
+	mutable_mhood_t<placeholder_request_t> cmd )
+{
+	m_logger->trace( "placeholder request received; path={}, connection_id={}",
+			cmd->m_path,
+			cmd->m_http_req->connection_id() );
+
+	m_last_client_request_at = std::chrono::steady_clock::now();
+
+	auto key = make_placeholder_key( cmd->m_path );
+
+	sobj_shptr_t<resize_request_t> request{ new resize_request_t{
+			std::move(cmd->m_http_req),
+			std::move(cmd->m_path),
+			key.format(),
+			key.params(),
+			key.quality(),
+			false,
+			false,
+			header_fields_list_t{},
+			std::move(cmd->m_active_request),
+			cmd->m_io_context } };
+
+	if( auto atoken = m_placeholders.lookup( request->m_image ) )
+	{
+		m_placeholders.update_access_time( *atoken );
+		send_placeholder( std::move(request), atoken->value() );
+	}
+	else if( !try_reject_known_failure( key, request ) )
+		// Placeholders are made by workers as usual transformations.
+		handle_not_transformed_image( std::move(key), std::move(request) );
+}
+
+[[nodiscard]] transform::resize_request_key_t
+a_transform_manager_t::make_placeholder_key( std::string path )
+{
+	return transform::resize_request_key_t{
+			std::move(path),
+			image_format_t::jpeg,
+			transform::resize_params_t::make(
+					std::nullopt, std::nullopt, placeholder_max_side ),
+			placeholder_quality,
+			true };
+}
+
+void
+a_transform_manager_t::store_placeholder_to_cache(
+	std::string path,
+	std::string data_uri )
+{
+	// The container ignores values for already known keys.
+	if( auto atoken = m_placeholders.lookup( path ) )
+		m_placeholders.erase( *atoken );
+
+	m_placeholders.insert( std::move(path), std::move(data_uri) );
+
+	while( max_placeholders < m_placeholders.size() )
+		m_placeholders.erase( m_placeholders.oldest().value() );
+}
+
+void
+a_transform_manager_t::send_placeholder(
+	sobj_shptr_t<resize_request_t> request,
+	std::string data_uri )
+{
+	make_response_on_io_context( std::move(request),
+			[data_uri = std::move(data_uri)]( resize_request_t & rq ) mutable {
+				do_200_plaintext_response(
+						std::move(rq.m_http_req),
+						std::move(data_uri) );
+			} );
+}
+
+void
+a_transform_manager_t::handle_resize_request(
+	transform::resize_request_key_t request_key,
+	sobj_shptr_t<resize_request_t> request )
+{
+	if( auto atoken = m_pinned_cache.m_images.lookup( request_key ) )
 		handle_request_for_already_transformed_image(
-				cmd.make_reference(),
+				std::move(request),
+				m_pinned_cache,
 				*atoken );
-	else
+	else if( auto atoken = m_transformed_cache.m_images.lookup( request_key ) )
+		handle_request_for_already_transformed_image(
+				std::move(request),
+				m_transformed_cache,
+				*atoken );
+	else if( !try_reject_known_failure( request_key, request ) )
 		handle_not_transformed_image(
 				std::move(request_key),
-				cmd.make_reference() );
+				std::move(request) );
 }
 
 void
@@ -100,9 +623,15 @@ a_transform_manager_t::on_resize_result(
 	try_initiate_pending_requests_processing();
 
 	// Extract all related to this image information from in-progress queue.
+	// There could be no requests if the image was transformed in advance.
 	auto key = std::move(cmd->m_key);
-	auto requests = extract_inprogress_requests(
-			std::move(m_inprogress_requests.find_first_for_key( key ).value()) );
+	original_request_container_t requests;
+	if( auto atoken = m_inprogress_requests.find_first_for_key( key ) )
+		requests = extract_inprogress_requests( std::move(*atoken) );
+
+	const bool pinned_prewarm = handle_prewarm_result(
+			key,
+			std::holds_alternative<successful_resize_t>( cmd->m_result ) );
 
 	// Perform actual processing of transformation result.
 	std::visit( variant_visitor{
@@ -110,7 +639,8 @@ a_transform_manager_t::on_resize_result(
 				on_successful_resize(
 						std::move(key),
 						result,
-						std::move(requests) );
+						std::move(requests),
+						pinned_prewarm );
 			},
 			[&]( failed_resize_t & result ) {
 				on_failed_resize(
@@ -121,20 +651,239 @@ a_transform_manager_t::on_resize_result(
 			cmd->m_result );
 }
 
+void
+a_transform_manager_t::on_prefetch_result(
+	mhood_t<prefetch_result_t> cmd )
+{
+	m_logger->trace( "prefetch_result received; path={}, successful={}",
+			cmd->m_path,
+			static_cast<bool>(cmd->m_source) );
+
+	m_inflight_prefetches.erase( cmd->m_path );
+
+	// The source could be changed while it was being read.
+	const bool outdated = 0u != m_outdated_prefetches.erase( cmd->m_path );
+
+	// If source can't be read the worker will detect and report that.
+	if( cmd->m_source && !outdated )
+		m_prefetched_sources.insert(
+				std::string{ cmd->m_path },
+				source_content_shared_ptr_t{ cmd->m_source } );
+
+	// Some pending request could wait for that source.
+	try_initiate_pending_requests_processing();
+}
+
+void
+a_transform_manager_t::on_source_changed(
+	mhood_t<source_changed_t> cmd )
+{
+	// All paths inside a directory have the same prefix.
+	std::string prefix = cmd->m_path;
+	if( cmd->m_is_directory && ( prefix.empty() || '/' != prefix.back() ) )
+		prefix += '/';
+
+	const auto affected = [&]( std::string_view path ) {
+		return cmd->m_is_directory ? starts_with( path, prefix ) : path == prefix;
+	};
+	const auto affected_key = [&]( const transform::resize_request_key_t & k ) {
+		return affected( k.path() );
+	};
+
+	const auto remove_from = [&]( auto & cache, const auto & in_range ) {
+		const auto outdated = cache.select_from(
+				std::string_view{ prefix }, in_range );
+		for( const auto & atoken : outdated )
+			cache.erase( atoken );
+	};
+
+	std::size_t removed_images{ 0u };
+	for( auto * cache : { &m_transformed_cache, &m_pinned_cache } )
+	{
+		const auto outdated_images = cache->m_images.select_from(
+				std::string_view{ prefix }, affected_key );
+		for( const auto & atoken : outdated_images )
+			remove_image_from_cache( *cache, atoken );
+
+		removed_images += outdated_images.size();
+	}
+
+	remove_from( m_failed_keys, affected_key );
+	remove_from( m_failed_sources, affected );
+	remove_from( m_placeholders, affected );
+	remove_from( m_source_infos, affected );
+	remove_from( m_prefetched_sources, affected );
+
+	for( const auto & path : m_inflight_prefetches )
+		if( affected( path ) )
+			m_outdated_prefetches.insert( path );
+
+	for( const auto & atoken : m_inprogress_requests.select_from(
+			std::string_view{ prefix }, affected_key ) )
+		m_outdated_inprogress_keys.insert( atoken.key() );
+
+	for( auto it = m_prewarm_inprogress.lower_bound( std::string_view{ prefix } );
+			it != m_prewarm_inprogress.end() && affected_key( it->first );
+			++it )
+		m_outdated_inprogress_keys.insert( it->first );
+
+	m_logger->debug( "source changed; path={}, is_directory={}, "
+			"removed_images={}",
+			cmd->m_path,
+			cmd->m_is_directory,
+			removed_images );
+}
+
 void
 a_transform_manager_t::on_delete_cache_request(
 	mutable_mhood_t<delete_cache_request_t> cmd )
 {
 	m_logger->warn( "delete cache request received; "
-			"connection_id={}, token={}",
+			"connection_id={}, token={}, selector={}, pattern={}",
 			cmd->m_http_req->connection_id(),
-			cmd->m_token );
+			cmd->m_token,
+			static_cast<int>(cmd->m_selector),
+			cmd->m_pattern );
+
+	if( !check_admin_token( cmd->m_http_req, cmd->m_token ) )
+		return;
+
+	removed_images_t removed;
+	for( auto * cache : { &m_transformed_cache, &m_pinned_cache } )
+	{
+		const auto r = remove_selected_images_from_cache( *cache, *cmd );
+		removed.m_count += r.m_count;
+		removed.m_bytes += r.m_bytes;
+	}
+
+	const auto removed_placeholders = remove_selected_placeholders( *cmd );
+
+	m_logger->info( "cache deleted; entries={}, bytes={}, placeholders={}",
+			removed.m_count,
+			removed.m_bytes,
+			removed_placeholders );
+
+	do_200_plaintext_response(
+			std::move(cmd->m_http_req),
+			fmt::format( "Cache deleted\r\n"
+					"Entries: {}\r\n"
+					"Bytes: {}\r\n"
+					"Placeholders: {}\r\n",
+					removed.m_count,
+					removed.m_bytes,
+					removed_placeholders ) );
+}
+
+void
+a_transform_manager_t::on_prewarm_request(
+	mutable_mhood_t<prewarm_request_t> cmd )
+{
+	m_logger->warn( "prewarm request received; "
+			"connection_id={}, token={}, images={}",
+			cmd->m_http_req->connection_id(),
+			cmd->m_token,
+			cmd->m_images.size() );
+
+	if( !check_admin_token( cmd->m_http_req, cmd->m_token ) )
+		return;
 
+	if( max_prewarm_queue_size - m_prewarm_queue.size() < cmd->m_images.size() )
+	{
+		m_logger->warn( "prewarm request is rejected because of overloading; "
+				"queue_size={}",
+				m_prewarm_queue.size() );
+
+		do_503_response( std::move(cmd->m_http_req) );
+		return;
+	}
+
+	remove_finished_prewarm_batches();
+
+	const auto batch_id = ++m_last_prewarm_batch_id;
+	auto & batch = m_prewarm_batches[ batch_id ];
+	batch.m_total = batch.m_queued = cmd->m_images.size();
+
+	for( auto & image : cmd->m_images )
+		m_prewarm_queue.emplace_back( batch_id, std::move(image) );
+
+	m_logger->info( "prewarm batch created; batch_id={}, images={}",
+			batch_id,
+			batch.m_total );
+
+	do_200_plaintext_response(
+			std::move(cmd->m_http_req),
+			fmt::format( "Batch: {}\r\n"
+					"Images: {}\r\n",
+					batch_id,
+					batch.m_total ) );
+
+	// There could be free workers.
+	try_initiate_pending_requests_processing();
+}
+
+void
+a_transform_manager_t::on_prewarm_status_request(
+	mutable_mhood_t<prewarm_status_request_t> cmd )
+{
+	m_logger->debug( "prewarm status request received; "
+			"connection_id={}, batch_id={}",
+			cmd->m_http_req->connection_id(),
+			cmd->m_batch_id );
+
+	if( !check_admin_token( cmd->m_http_req, cmd->m_token ) )
+		return;
+
+	const auto it = m_prewarm_batches.find( cmd->m_batch_id );
+	if( it == m_prewarm_batches.end() )
+	{
+		do_404_response( std::move(cmd->m_http_req) );
+		return;
+	}
+
+	const auto & batch = it->second;
+	do_200_plaintext_response(
+			std::move(cmd->m_http_req),
+			fmt::format( "Batch: {}\r\n"
+					"Status: {}\r\n"
+					"Images: {}\r\n"
+					"Queued: {}\r\n"
+					"In-progress: {}\r\n"
+					"Transformed: {}\r\n"
+					"Skipped: {}\r\n"
+					"Failed: {}\r\n",
+					it->first,
+					batch.finished() ? "finished" : "in-progress",
+					batch.m_total,
+					batch.m_queued,
+					batch.m_inprogress,
+					batch.m_transformed,
+					batch.m_skipped,
+					batch.m_failed ) );
+}
+
+void
+a_transform_manager_t::on_negative_admin_response(
+	mutable_mhood_t<negative_admin_response_t> cmd )
+{
+	m_logger->debug( "send negative response to admin request; "
+			"connection_id={}",
+			cmd->m_http_req->connection_id() );
+
+	do_403_response(
+			std::move(cmd->m_http_req),
+			std::move(cmd->m_response_text) );
+}
+
+[[nodiscard]] bool
+a_transform_manager_t::check_admin_token(
+	restinio::request_handle_t & http_req,
+	const std::string & token )
+{
 	const auto delay_response = [&]( std::string response_text ) {
-		so_5::send_delayed< so_5::mutable_msg<negative_delete_cache_response_t> >(
+		so_5::send_delayed< so_5::mutable_msg<negative_admin_response_t> >(
 				*this,
 				std::chrono::seconds{7},
-				std::move(cmd->m_http_req),
+				std::move(http_req),
 				std::move(response_text) );
 	};
 
@@ -142,66 +891,58 @@ a_transform_manager_t::on_delete_cache_request(
 			// Token must be present and must not be empty.
 			env_token && *env_token )
 	{
-		if( cmd->m_token == env_token )
-		{
-			m_transformed_cache.clear();
+		if( token == env_token )
+			return true;
 
-			m_logger->info( "cache deleted" );
+		m_logger->error( "invalid token value for admin request; token={}",
+				token );
 
-			do_200_plaintext_response(
-					std::move(cmd->m_http_req),
-					"Cache deleted\r\n" );
-		}
-		else
-		{
-			m_logger->error( "invalid token value for delete cache request; "
-					"token={}",
-					cmd->m_token );
-
-			delay_response( "Token value mismatch\r\n" );
-		}
+		delay_response( "Token value mismatch\r\n" );
 	}
 	else
 	{
-		m_logger->warn( "delete cache can't be performed because there is no "
+		m_logger->warn( "admin request can't be performed because there is no "
 				"admin token defined" );
 
 		// Operation can't be performed because admin token is not avaliable.
 		delay_response( "No admin token defined\r\n" );
 	}
-}
-
-void
-a_transform_manager_t::on_negative_delete_cache_response(
-	mutable_mhood_t<negative_delete_cache_response_t> cmd )
-{
-	m_logger->debug( "send negative response to delete cache request; "
-			"connection_id={}",
-			cmd->m_http_req->connection_id() );
 
-	do_403_response(
-			std::move(cmd->m_http_req),
-			std::move(cmd->m_response_text) );
+	return false;
 }
 
 void
 a_transform_manager_t::on_clear_cache(
 	mhood_t<clear_cache_t> )
 {
-	const auto time_border = std::chrono::steady_clock::now() - max_cache_lifetime;
-	while( !m_transformed_cache.empty() )
+	const auto time_border =
+			std::chrono::steady_clock::now() - m_params.m_max_cache_lifetime;
+	// Images in the pinned cache are not removed because of their age.
+	while( !m_transformed_cache.m_images.empty() )
 	{
-		auto atoken = m_transformed_cache.oldest().value();
+		auto atoken = m_transformed_cache.m_images.oldest().value();
 		if( atoken.access_time() < time_border )
 		{
 			// This image is too old and should be removed.
-			m_transformed_cache.erase( atoken );
+			remove_image_from_cache( m_transformed_cache, atoken );
 		}
 		else
 			// Clearance procedure can be stopped because this and all other
 			// images are too young to be removed from cache.
 			break;
 	}
+
+	remove_expired_failures();
+
+	m_logger->info( "cache stats; images={}, memory={}, pinned_images={}, "
+			"pinned_memory={}, placeholders={}, quantized_requests={}",
+			m_transformed_cache.m_images.size(),
+			m_transformed_cache.m_memory_size,
+			m_pinned_cache.m_images.size(),
+			m_pinned_cache.m_memory_size,
+			m_placeholders.size(),
+			m_quantized_requests );
+	m_quantized_requests = 0u;
 }
 
 void
@@ -216,40 +957,121 @@ a_transform_manager_t::on_check_pending_requests(
 		if( atoken.access_time() < time_border )
 		{
 			// This request should be removed.
-			auto http_req = std::move(atoken.value()->m_http_req);
+			auto request = atoken.value();
 
 			m_logger->warn( "reject pending request, too long waiting time; "
 					"request_key={}, connection_id={}",
 					atoken.key(),
-					http_req->connection_id() );
+					request->connection_id() );
 
 			m_pending_requests.erase( std::move(atoken) );
-			do_504_response( std::move(http_req) );
+			send_negative_response( std::move(request), 504u );
 		}
 		else
 			break;
 	}
+
+	// Sources read in advance for requests which were rejected
+	// should be removed too.
+	while( !m_prefetched_sources.empty() )
+	{
+		auto atoken = m_prefetched_sources.oldest().value();
+		if( atoken.access_time() < time_border )
+			m_prefetched_sources.erase( atoken );
+		else
+			break;
+	}
+
+	// The only worker could wait for a pause in requests from clients
+	// to be used for prewarm.
+	try_initiate_pending_requests_processing();
 }
 
 void
 a_transform_manager_t::handle_request_for_already_transformed_image(
 	sobj_shptr_t<resize_request_t> cmd,
+	images_cache_t & cache,
 	cache_t::access_token_t atoken )
 {
 	m_logger->debug( "transformed image is present in cache; request_key={}",
 			atoken.key() );
 
 	// Access time for the cached image should be updated on every access.
-	m_transformed_cache.update_access_time( atoken );
+	cache.m_images.update_access_time( atoken );
+
+	const bool pinned = cmd->m_pinned;
 
 	// Form a HTTP-response for that request.
-	serve_transformed_image(
-			std::move(cmd->m_http_req),
-			atoken.value(),
-			cmd->m_target_format,
-			http_header::image_src_t::cache,
-			make_header_fields_list(
-					http_header::shrimp_total_processing_time_hf(), "0" ) );
+	if( cmd->m_batch )
+		complete_batch_item( *cmd, 200u, atoken.value() );
+	else
+		make_response_on_io_context( std::move(cmd),
+				[blob = atoken.value()]( resize_request_t & rq ) mutable {
+					auto headers = make_header_fields_list(
+							http_header::shrimp_total_processing_time_hf(), "0" );
+					std::move( rq.m_response_headers.begin(),
+							rq.m_response_headers.end(),
+							std::back_inserter( headers ) );
+
+					serve_transformed_image(
+							std::move(rq.m_http_req),
+							std::move(blob),
+							rq.m_target_format,
+							http_header::image_src_t::cache,
+							std::move(headers) );
+				} );
+
+	// An image for pinned preset could be stored in the usual cache
+	// (if the pinned cache was full or the image was requested without
+	// a preset). It should be moved to the pinned cache if possible.
+	if( pinned && &cache != &m_pinned_cache &&
+			try_store_image_to_pinned_cache(
+					transform::resize_request_key_t{ atoken.key() },
+					datasizable_blob_shared_ptr_t{ atoken.value() } ) )
+		remove_image_from_cache( cache, atoken );
+}
+
+[[nodiscard]] bool
+a_transform_manager_t::is_cached(
+	const transform::resize_request_key_t & key )
+{
+	return m_pinned_cache.m_images.lookup( key ) ||
+			m_transformed_cache.m_images.lookup( key );
+}
+
+[[nodiscard]] bool
+a_transform_manager_t::has_known_failure(
+	const transform::resize_request_key_t & key )
+{
+	// Expired failures must be ignored. They will be removed by
+	// the next clear_cache signal.
+	const auto time_border =
+			std::chrono::steady_clock::now() - m_params.m_negative_cache_ttl;
+
+	// A fresh failure of the key must not be hidden by an expired
+	// failure of the source. So both containers are checked.
+	const auto is_fresh = [&time_border]( const auto & atoken ) {
+		return atoken && !( atoken->access_time() < time_border );
+	};
+
+	return is_fresh( m_failed_sources.lookup( key.path() ) ) ||
+			is_fresh( m_failed_keys.lookup( key ) );
+}
+
+[[nodiscard]] bool
+a_transform_manager_t::try_reject_known_failure(
+	const transform::resize_request_key_t & key,
+	sobj_shptr_t<resize_request_t> & cmd )
+{
+	if( !has_known_failure( key ) )
+		return false;
+
+	m_logger->debug( "request is rejected because of recent failure; "
+			"request_key={}",
+			key );
+
+	send_negative_response( std::move(cmd), 404u );
+	return true;
 }
 
 void
@@ -261,7 +1083,8 @@ a_transform_manager_t::handle_not_transformed_image(
 		queue.insert( std::move(request_key), std::move(cmd) );
 	};
 
-	if( m_inprogress_requests.has_key( request_key ) )
+	if( m_inprogress_requests.has_key( request_key ) ||
+			m_prewarm_inprogress.count( request_key ) )
 	{
 		// Same request is already in progress.
 		m_logger->debug( "same request is already in progress; request_key={}",
@@ -284,8 +1107,12 @@ a_transform_manager_t::handle_not_transformed_image(
 		m_logger->debug( "store request to pending requests queue; request_key={}",
 				request_key );
 
+		const auto path = request_key.path();
 		store_to( m_pending_requests );
 
+		// Source image can be read while the request is waiting.
+		try_initiate_prefetch( path );
+
 		// If there is a free worker then we can push a request to processing.
 		try_initiate_pending_requests_processing();
 	}
@@ -296,20 +1123,56 @@ a_transform_manager_t::handle_not_transformed_image(
 				"request_key={}",
 				request_key );
 
-		do_503_response( std::move(cmd->m_http_req) );
+		send_negative_response( std::move(cmd), 503u );
 	}
 }
 
+void
+a_transform_manager_t::try_initiate_prefetch( const std::string & path )
+{
+	if( !m_prefetcher ||
+			m_inflight_prefetches.size() >= m_params.m_max_inflight_prefetches ||
+			m_prefetched_sources.lookup( path ) ||
+			m_inflight_prefetches.count( path ) )
+		return;
+
+	m_logger->trace( "initiate prefetch of a source; path={}", path );
+
+	m_inflight_prefetches.insert( path );
+	so_5::send< a_source_prefetcher_t::prefetch_request_t >(
+			m_prefetcher,
+			path,
+			so_direct_mbox() );
+}
+
 void
 a_transform_manager_t::try_initiate_pending_requests_processing()
 {
 	// Let's try to find unique request which isn't in a cache yet.
 	// But do the search only if there is at least one free worker.
-	while( !m_free_workers.empty() && !m_pending_requests.empty() )
+	while( !m_free_workers.empty() )
 	{
-		auto atoken = m_pending_requests.oldest().value();
+		// If the source image is being read now the request should
+		// wait for the completion of the reading. But requests for
+		// other images can be processed meanwhile.
+		auto found = m_pending_requests.oldest_if(
+				[this]( const transform::resize_request_key_t & k ) {
+					return 0u == m_inflight_prefetches.count( k.path() );
+				} );
+		if( !found )
+			break;
+
+		auto atoken = std::move(*found);
 		const auto key = atoken.key();
 
+		// Source image could be already read in advance.
+		source_content_shared_ptr_t source;
+		if( auto source_atoken = m_prefetched_sources.lookup( key.path() ) )
+		{
+			source = std::move(source_atoken->value());
+			m_prefetched_sources.erase( *source_atoken );
+		}
+
 		// We can't restore is an exception will be thrown during
 		// requests movement.
 		[&]() noexcept {
@@ -335,51 +1198,214 @@ a_transform_manager_t::try_initiate_pending_requests_processing()
 		so_5::send< so_5::mutable_msg<a_transformer_t::resize_request_t> >(
 				worker,
 				key,
+				std::move(source),
 				so_direct_mbox() );
 	}
+
+	// Workers which are still free can be used for images
+	// to be transformed in advance.
+	if( m_pending_requests.empty() )
+		try_initiate_prewarm_processing();
+}
+
+void
+a_transform_manager_t::try_initiate_prewarm_processing()
+{
+	// At least one worker should be left for requests from clients.
+	// The only worker is used only when clients are quiet, otherwise
+	// a client would wait for the end of a prewarm transformation.
+	const bool clients_are_quiet = m_last_client_request_at +
+			prewarm_quiet_period < std::chrono::steady_clock::now();
+	const std::size_t max_prewarm_workers = 1u < m_workers_count ?
+			m_workers_count - 1u :
+			( clients_are_quiet ? 1u : 0u );
+
+	while( !m_free_workers.empty() && !m_prewarm_queue.empty() &&
+			m_prewarm_inprogress.size() < max_prewarm_workers )
+	{
+		const auto batch_id = m_prewarm_queue.front().first;
+		const bool pinned = m_prewarm_queue.front().second.m_pinned;
+		// Sizes of sources could become known while images were queued.
+		auto key = make_canonical_key( m_prewarm_queue.front().second );
+		m_prewarm_queue.pop_front();
+
+		// Batch can't be removed while it has queued images.
+		auto & batch = m_prewarm_batches.at( batch_id );
+		batch.m_queued -= 1u;
+
+		if( is_cached( key ) ||
+				m_inprogress_requests.has_key( key ) ||
+				m_prewarm_inprogress.count( key ) )
+		{
+			// An image for pinned preset could be already stored in
+			// the usual cache. It should be moved to the pinned cache.
+			if( auto atoken = m_transformed_cache.m_images.lookup( key );
+					pinned && atoken &&
+					try_store_image_to_pinned_cache(
+							transform::resize_request_key_t{ key },
+							datasizable_blob_shared_ptr_t{ atoken->value() } ) )
+				remove_image_from_cache( m_transformed_cache, *atoken );
+
+			batch.m_skipped += 1u;
+			continue;
+		}
+
+		if( has_known_failure( key ) )
+		{
+			batch.m_failed += 1u;
+			continue;
+		}
+
+		auto worker = std::move(m_free_workers.top());
+		m_free_workers.pop();
+
+		m_logger->trace( "initiate processing of a prewarm request; "
+				"batch_id={}, request_key={}, worker_mbox={}",
+				batch_id, key, worker->id() );
+
+		batch.m_inprogress += 1u;
+		m_prewarm_inprogress.emplace(
+				key, prewarm_inprogress_item_t{ batch_id, pinned } );
+
+		so_5::send< so_5::mutable_msg<a_transformer_t::resize_request_t> >(
+				worker,
+				std::move(key),
+				source_content_shared_ptr_t{},
+				so_direct_mbox() );
+	}
+}
+
+[[nodiscard]] bool
+a_transform_manager_t::handle_prewarm_result(
+	const transform::resize_request_key_t & key,
+	bool successful )
+{
+	const auto it = m_prewarm_inprogress.find( key );
+	if( it == m_prewarm_inprogress.end() )
+		return false;
+
+	const auto [batch_id, pinned] = it->second;
+	auto & batch = m_prewarm_batches.at( batch_id );
+	batch.m_inprogress -= 1u;
+	( successful ? batch.m_transformed : batch.m_failed ) += 1u;
+
+	if( batch.finished() )
+		m_logger->info( "prewarm batch finished; batch_id={}, transformed={}, "
+				"skipped={}, failed={}",
+				batch_id,
+				batch.m_transformed,
+				batch.m_skipped,
+				batch.m_failed );
+
+	m_prewarm_inprogress.erase( it );
+
+	return pinned;
+}
+
+void
+a_transform_manager_t::remove_finished_prewarm_batches()
+{
+	// Batches are ordered by IDs, so the oldest ones are removed first.
+	for( auto it = m_prewarm_batches.begin();
+			it != m_prewarm_batches.end() &&
+				max_prewarm_batches <= m_prewarm_batches.size(); )
+	{
+		if( it->second.finished() )
+			it = m_prewarm_batches.erase( it );
+		else
+			++it;
+	}
 }
 
 void
 a_transform_manager_t::on_successful_resize(
 	transform::resize_request_key_t key,
 	successful_resize_t & result,
-	original_request_container_t requests )
+	original_request_container_t requests,
+	bool pinned_prewarm )
 {
 	m_logger->debug( "successul resize result; request_key={}, blob_size={}",
 			key,
 			result.m_image_blob->size() );
 
-	store_transformed_image_to_cache(
-			transform::resize_request_key_t{ key },
-			datasizable_blob_shared_ptr_t{ result.m_image_blob } );
+	// Placeholders are stored in their own cache as data URIs.
+	std::string data_uri;
+	const bool placeholder = key.placeholder();
+	if( placeholder )
+		data_uri = make_data_uri( *result.m_image_blob, key.format() );
+
+	// The result made from outdated source must not be cached.
+	// But it is still can be sent to requests which were received
+	// before the source change.
+	const bool outdated = 0u != m_outdated_inprogress_keys.erase( key );
+	if( !outdated && result.m_source_info )
+		store_source_info( std::string{ key.path() }, *result.m_source_info );
+
+	if( !outdated && placeholder )
+		store_placeholder_to_cache( std::string{ key.path() }, data_uri );
+	else if( !outdated )
+	{
+		const bool pinned = pinned_prewarm ||
+				std::any_of( requests.begin(), requests.end(),
+						[]( const auto & rq ) { return rq->m_pinned; } );
+
+		store_transformed_image_to_cache(
+				transform::resize_request_key_t{ key },
+				datasizable_blob_shared_ptr_t{ result.m_image_blob },
+				pinned );
+	}
 
 	// Milliseconds with fractions from microseconds.
 	const auto us_to_ms = [](auto us) { return us.count() / 1000.0; };
 
-	// Additional headers for every response.
-	auto additional_headers = make_header_fields_list(
+	// Additional headers for every response. They are copied
+	// for every response on the context of its server.
+	const auto additional_headers = std::make_shared< header_fields_list_t >(
+		make_header_fields_list(
 			http_header::shrimp_total_processing_time_hf(),
 			fmt::format( "{}",
 					us_to_ms(result.m_resize_duration + result.m_encoding_duration) ),
 			http_header::shrimp_resize_time_hf(),
 			fmt::format( "{}", us_to_ms(result.m_resize_duration) ),
 			http_header::shrimp_encoding_time_hf(),
-			fmt::format( "{}", us_to_ms(result.m_encoding_duration) ) );
+			fmt::format( "{}", us_to_ms(result.m_encoding_duration) ) ) );
 
 	for( auto & rq : requests )
 	{
 		m_logger->trace( "sending positive response back; "
 				"request_key={}, connection_id={}",
 				key,
-				rq->m_http_req->connection_id() );
+				rq->connection_id() );
+
+		if( rq->m_batch )
+		{
+			complete_batch_item( *rq, 200u, result.m_image_blob );
+			continue;
+		}
+
+		if( placeholder )
+		{
+			send_placeholder( std::move(rq), data_uri );
+			continue;
+		}
 
 		// Transformed image can be sent as response.
-		serve_transformed_image(
-				std::move(rq->m_http_req),
-				result.m_image_blob,
-				rq->m_target_format,
-				http_header::image_src_t::transform,
-				additional_headers );
+		make_response_on_io_context( std::move(rq),
+				[blob = result.m_image_blob, additional_headers](
+					resize_request_t & request ) mutable
+				{
+					auto headers = *additional_headers;
+					std::move( request.m_response_headers.begin(),
+							request.m_response_headers.end(),
+							std::back_inserter( headers ) );
+
+					serve_transformed_image(
+							std::move(request.m_http_req),
+							std::move(blob),
+							request.m_target_format,
+							http_header::image_src_t::transform,
+							std::move(headers) );
+				} );
 	}
 }
 
@@ -393,40 +1419,250 @@ a_transform_manager_t::on_failed_resize(
 			key,
 			result.m_reason );
 
+	if( !m_outdated_inprogress_keys.erase( key ) )
+		store_failure_to_cache( key, result.m_reason_code );
+
 	for( auto & rq : requests )
 	{
 		m_logger->trace( "sending negative response back; "
 				"request_key={}, connection_id={}",
 				key,
-				rq->m_http_req->connection_id() );
+				rq->connection_id() );
 
-		do_404_response( std::move(rq->m_http_req) );
+		send_negative_response( std::move(rq), 404u );
 	}
 }
 
+void
+a_transform_manager_t::complete_batch_item(
+	resize_request_t & request,
+	std::uint16_t status,
+	datasizable_blob_shared_ptr_t blob )
+{
+	auto & batch = *request.m_batch;
+
+	auto & rendition = batch.m_renditions[ request.m_batch_item ];
+	rendition.m_status = status;
+	rendition.m_blob = std::move(blob);
+
+	if( 0u != --batch.m_remaining )
+		return;
+
+	m_logger->trace( "sending response for rendition batch; "
+			"connection_id={}, images={}",
+			batch.m_http_req->connection_id(),
+			batch.m_renditions.size() );
+
+	const auto send = [batch = request.m_batch] {
+		serve_renditions(
+				std::move(batch->m_http_req),
+				std::move(batch->m_renditions) );
+	};
+
+	if( auto * io_context = batch.m_io_context )
+		restinio::asio_ns::post( *io_context, send );
+	else
+		send();
+}
+
+void
+a_transform_manager_t::send_negative_response(
+	sobj_shptr_t<resize_request_t> request,
+	std::uint16_t status )
+{
+	if( request->m_batch )
+	{
+		complete_batch_item( *request, status );
+		return;
+	}
+
+	make_response_on_io_context( std::move(request),
+			[status]( resize_request_t & rq ) {
+				switch( status )
+				{
+					case 503u: do_503_response( std::move(rq.m_http_req) ); break;
+					case 504u: do_504_response( std::move(rq.m_http_req) ); break;
+					default: do_404_response( std::move(rq.m_http_req) ); break;
+				}
+			} );
+}
+
+void
+a_transform_manager_t::store_failure_to_cache(
+	const transform::resize_request_key_t & key,
+	failure_reason_t reason )
+{
+	if( !m_params.m_max_negative_cache_entries )
+		return;
+
+	// An existing entry is removed first because insert() ignores
+	// existing keys and the timestamp of an expired entry wouldn't
+	// be refreshed otherwise.
+	//
+	// If the source image can't be read then any transformation of it
+	// will fail.
+	if( failure_reason_t::source_failure == reason )
+	{
+		if( auto atoken = m_failed_sources.lookup( key.path() ) )
+			m_failed_sources.erase( *atoken );
+		m_failed_sources.insert( std::string{ key.path() }, std::move(reason) );
+	}
+	else
+	{
+		if( auto atoken = m_failed_keys.lookup( key ) )
+			m_failed_keys.erase( *atoken );
+		m_failed_keys.insert(
+				transform::resize_request_key_t{ key },
+				std::move(reason) );
+	}
+
+	// The oldest failures must be removed if there are too many of them.
+	while( m_failed_sources.size() + m_failed_keys.size() >
+			m_params.m_max_negative_cache_entries )
+	{
+		auto oldest_source = m_failed_sources.oldest();
+		auto oldest_key = m_failed_keys.oldest();
+
+		if( oldest_source && ( !oldest_key ||
+				oldest_source->access_time() < oldest_key->access_time() ) )
+			m_failed_sources.erase( *oldest_source );
+		else
+			m_failed_keys.erase( *oldest_key );
+	}
+}
+
+void
+a_transform_manager_t::remove_expired_failures()
+{
+	const auto time_border =
+			std::chrono::steady_clock::now() - m_params.m_negative_cache_ttl;
+
+	const auto remove_from = [&time_border]( auto & cache ) {
+		while( !cache.empty() )
+		{
+			auto atoken = cache.oldest().value();
+			if( atoken.access_time() < time_border )
+				cache.erase( atoken );
+			else
+				break;
+		}
+	};
+
+	remove_from( m_failed_sources );
+	remove_from( m_failed_keys );
+}
+
 void
 a_transform_manager_t::store_transformed_image_to_cache(
 	transform::resize_request_key_t key,
-	datasizable_blob_shared_ptr_t image_blob )
+	datasizable_blob_shared_ptr_t image_blob,
+	bool pinned )
 {
-	// Precalculate the new size of a cache.
-	const auto updated_cache_size = m_transformed_cache_memory_size +
-			image_blob->size();
+	if( pinned && try_store_image_to_pinned_cache( key, image_blob ) )
+		return;
 
 	// Move transformed image into cache.
 	m_transformed_cache.insert( std::move(key), std::move(image_blob) );
-	m_transformed_cache_memory_size = updated_cache_size;
 
 	// Cache can exceed it max size. Some old images must be removed
 	// in that case. But at least one image should stay inside the cache.
 	while(
-		max_transformed_cache_memory_size < m_transformed_cache_memory_size &&
-		1 < m_transformed_cache.size() )
+		max_transformed_cache_memory_size < m_transformed_cache.m_memory_size &&
+		1 < m_transformed_cache.m_images.size() )
+		remove_image_from_cache(
+				m_transformed_cache,
+				m_transformed_cache.m_images.oldest().value() );
+}
+
+[[nodiscard]] bool
+a_transform_manager_t::try_store_image_to_pinned_cache(
+	transform::resize_request_key_t key,
+	datasizable_blob_shared_ptr_t image_blob )
+{
+	const auto updated_cache_size = m_pinned_cache.m_memory_size +
+			m_pinned_cache.memory_size_for( *image_blob );
+	if( m_params.m_max_pinned_cache_memory_size < updated_cache_size )
 	{
-		auto atoken = m_transformed_cache.oldest().value();
-		m_transformed_cache_memory_size -= atoken.value()->size();
-		m_transformed_cache.erase( atoken );
+		m_logger->debug( "no space in the pinned cache; request_key={}, "
+				"cache_size={}",
+				key,
+				m_pinned_cache.m_memory_size );
+		return false;
 	}
+
+	m_pinned_cache.insert( std::move(key), std::move(image_blob) );
+
+	return true;
+}
+
+void
+a_transform_manager_t::remove_image_from_cache(
+	images_cache_t & cache,
+	cache_t::access_token_t atoken )
+{
+	cache.erase( atoken );
+}
+
+void
+a_transform_manager_t::remove_all_images_from_cache( images_cache_t & cache )
+{
+	cache.clear();
+}
+
+a_transform_manager_t::removed_images_t
+a_transform_manager_t::remove_selected_images_from_cache(
+	images_cache_t & cache,
+	const delete_cache_request_t & request )
+{
+	using selector_t = delete_cache_request_t::selector_t;
+
+	removed_images_t result;
+
+	if( selector_t::all == request.m_selector )
+	{
+		result.m_count = cache.m_images.size();
+		result.m_bytes = cache.m_memory_size;
+		remove_all_images_from_cache( cache );
+		return result;
+	}
+
+	const auto memory_size_before = cache.m_memory_size;
+	const auto selected = select_for_deletion( cache.m_images, request,
+			[]( const transform::resize_request_key_t & k ) -> const std::string & {
+				return k.path();
+			} );
+	for( const auto & atoken : selected )
+		remove_image_from_cache( cache, atoken );
+
+	result.m_count = selected.size();
+	// Identical images are shared between keys, so only the memory
+	// actually released is reported.
+	result.m_bytes = memory_size_before - cache.m_memory_size;
+
+	return result;
+}
+
+std::size_t
+a_transform_manager_t::remove_selected_placeholders(
+	const delete_cache_request_t & request )
+{
+	using selector_t = delete_cache_request_t::selector_t;
+
+	if( selector_t::all == request.m_selector )
+	{
+		const auto count = m_placeholders.size();
+		m_placeholders.clear();
+		return count;
+	}
+
+	const auto selected = select_for_deletion( m_placeholders, request,
+			[]( const std::string & path ) -> const std::string & {
+				return path;
+			} );
+	for( const auto & atoken : selected )
+		m_placeholders.erase( atoken );
+
+	return selected.size();
 }
 
 [[nodiscard]]
@@ -445,5 +1681,83 @@ a_transform_manager_t::extract_inprogress_requests(
 	return result;
 }
 
+//
+// a_transform_manager_t::images_cache_t
+//
+
+[[nodiscard]] std::size_t
+a_transform_manager_t::images_cache_t::memory_size_for(
+	const datasizable_blob_t & blob ) const
+{
+	return find_identical( blob ) ? 0u : blob.size();
+}
+
+void
+a_transform_manager_t::images_cache_t::insert(
+	transform::resize_request_key_t key,
+	datasizable_blob_shared_ptr_t blob )
+{
+	// The container ignores values for already known keys.
+	if( m_images.lookup( key ) )
+		return;
+
+	auto it = m_unique_blobs.find( blob->m_hash );
+	if( it == m_unique_blobs.end() )
+	{
+		m_memory_size += blob->size();
+		m_unique_blobs.emplace( blob->m_hash, unique_blob_t{ blob, 1u } );
+	}
+	else if( it->second.m_blob->same_content( *blob ) )
+	{
+		it->second.m_references += 1u;
+		blob = it->second.m_blob;
+	}
+	else
+		// A collision of hashes. The image is stored as is
+		// without sharing.
+		m_memory_size += blob->size();
+
+	m_images.insert( std::move(key), std::move(blob) );
+}
+
+void
+a_transform_manager_t::images_cache_t::erase( cache_t::access_token_t atoken )
+{
+	const auto & blob = atoken.value();
+
+	auto it = m_unique_blobs.find( blob->m_hash );
+	if( it != m_unique_blobs.end() && it->second.m_blob == blob )
+	{
+		if( 0u == --it->second.m_references )
+		{
+			m_memory_size -= blob->size();
+			m_unique_blobs.erase( it );
+		}
+	}
+	else
+		m_memory_size -= blob->size();
+
+	m_images.erase( atoken );
+}
+
+void
+a_transform_manager_t::images_cache_t::clear()
+{
+	m_images.clear();
+	m_unique_blobs.clear();
+	m_memory_size = 0u;
+}
+
+[[nodiscard]] const a_transform_manager_t::images_cache_t::unique_blob_t *
+a_transform_manager_t::images_cache_t::find_identical(
+	const datasizable_blob_t & blob ) const
+{
+	const auto it = m_unique_blobs.find( blob.m_hash );
+	if( it != m_unique_blobs.end() && it->second.m_blob->same_content( blob ) )
+		return &it->second;
+
+	return nullptr;
+}
+
 } /* namespace shrimp */
 
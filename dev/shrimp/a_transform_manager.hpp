@@ -10,17 +10,26 @@
 #pragma once
 
 #include <shrimp/transforms.hpp>
+#include <shrimp/active_requests_limiter.hpp>
+#include <shrimp/app_params.hpp>
 #include <shrimp/cache_alike_container.hpp>
 #include <shrimp/key_multivalue_queue.hpp>
+#include <shrimp/source_files.hpp>
+#include <shrimp/response_common.hpp>
 
 #include <so_5/all.hpp>
 #include <restinio/all.hpp>
 
 #include <spdlog/spdlog.h>
 
+#include <deque>
+#include <map>
 #include <queue>
+#include <set>
 #include <stack>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace shrimp {
 
@@ -34,19 +43,61 @@ namespace shrimp {
  * of pending requests. When a free transformer (worker) agent become
  * available a pending request will be scheduled to that free worker.
  *
+ * When a new request is added to the queue of pending requests the reading
+ * of the source image is initiated in advance (if there is a free slot for
+ * that). Such pending request isn't scheduled to a worker until the reading
+ * is finished, so the worker decodes the image from the memory.
+ *
  * This agent receives results from workers and produces responses to
  * original requests.
  *
+ * Requested sizes are rounded up to the ladder of sizes and canonicalized
+ * by this agent. Sizes of source images are remembered from results of
+ * workers, so requests which don't change the image are served by
+ * the source file itself.
+ *
  * This agent periodically checks queue of pending requests. If a request is
  * in the queue for a long time then this request will be removed and
  * negative response will be sent to the original request.
  *
+ * Images for pinned presets are stored in a separate cache. Images from
+ * that cache are not removed because of their age or because of the lack
+ * of space for new images.
+ *
  * This agent periodically checks cache's contents and removes too old
- * images from it.
+ * images from it. Images made from a changed or removed source are
+ * removed from the cache immediately when the change is detected.
+ *
+ * Images can be transformed in advance by requests from prewarm batches.
+ * Those requests are processed only by idle workers when there is no
+ * pending requests from clients. At least one worker is always left
+ * for requests from clients. If there is only one worker it is used
+ * for prewarm only after a pause in requests from clients.
+ *
+ * Failed transformations are remembered for a short time. Repeated
+ * requests for the same image are rejected immediately during that time.
+ * If the source image can't be read or decoded all requests for that
+ * image are rejected, not only the ones with the same parameters.
+ *
+ * Several images can be requested by one request from a client (a batch
+ * of renditions). Every image from the batch is handled as a usual
+ * request (served from the cache or transformed by a worker), the response
+ * is sent when all images from the batch are handled.
+ *
+ * Requests for information about a source image are answered by this
+ * agent without workers. The header of the source is read by the source
+ * reader agent (the prefetcher) on its own thread pool, this agent adds
+ * the list of cached images for it.
+ *
+ * Tiny placeholders for images are made by workers as usual
+ * transformations. They are stored as data URIs in a separate cache,
+ * so they don't push large images out of the cache of transformed images.
  */
 class a_transform_manager_t final : public so_5::agent_t
 {
 public:
+	struct rendition_batch_t;
+
 	//! A request to be used for new transformation.
 	/*!
 	 * \note This message should be sent as mutable message.
@@ -60,17 +111,137 @@ public:
 		//! Target format of image to be transformed.
 		image_format_t m_target_format;
 		//! Transformation parameters.
+		/*!
+		 * Parameters from the client are replaced by the canonical ones
+		 * when the request is received by the manager.
+		 */
 		transform::resize_params_t m_params;
+		//! Quality for the encoder. Value 0 means the default quality.
+		std::uint32_t m_quality;
+		//! Should the transformed image be kept in the cache permanently?
+		bool m_pinned;
+		//! Should the requested size be rounded up to the ladder of sizes?
+		/*!
+		 * Sizes from presets are used as is.
+		 */
+		bool m_quantize;
+		//! Additional header fields for the response.
+		header_fields_list_t m_response_headers;
+		//! Slot of the request in the limit of active requests.
+		/*!
+		 * It is released when the request is destroyed.
+		 */
+		active_request_guard_t m_active_request;
+		//! Context of the server which received the request.
+		/*!
+		 * The response is made on that context. Can be nullptr, the
+		 * response is made on the manager's thread in that case.
+		 */
+		restinio::asio_ns::io_context * m_io_context;
+		//! A batch of renditions this request belongs to.
+		/*!
+		 * Is empty for usual requests. If it isn't empty then
+		 * \a m_http_req is empty and the result is stored into the batch.
+		 */
+		std::shared_ptr< rendition_batch_t > m_batch;
+		//! Index of the image in the batch.
+		std::size_t m_batch_item{ 0u };
 
 		resize_request_t(
 			restinio::request_handle_t http_req,
 			std::string image,
 			image_format_t target_format,
-			transform::resize_params_t params )
+			transform::resize_params_t params,
+			std::uint32_t quality = 0u,
+			bool pinned = false,
+			bool quantize = false,
+			header_fields_list_t response_headers = {},
+			active_request_guard_t active_request = {},
+			restinio::asio_ns::io_context * io_context = nullptr )
 			: m_http_req{ std::move(http_req) }
 			, m_image{ std::move(image) }
 			, m_target_format{ target_format }
 			, m_params{ params }
+			, m_quality{ quality }
+			, m_pinned{ pinned }
+			, m_quantize{ quantize }
+			, m_response_headers{ std::move(response_headers) }
+			, m_active_request{ std::move(active_request) }
+			, m_io_context{ io_context }
+		{}
+
+		//! ID of the connection of the original HTTP-request.
+		[[nodiscard]] restinio::connection_id_t
+		connection_id() const;
+	};
+
+	//! A batch of renditions which is being handled.
+	struct rendition_batch_t
+	{
+		//! Original HTTP-request.
+		restinio::request_handle_t m_http_req;
+		//! Results for images in the order from the request.
+		renditions_t m_renditions;
+		//! Count of images which are not handled yet.
+		std::size_t m_remaining;
+		//! Context of the server which received the request.
+		restinio::asio_ns::io_context * m_io_context;
+	};
+
+	//! An image requested by its URL in a batch.
+	struct requested_image_t
+	{
+		//! Identification of the image.
+		/*!
+		 * Parameters are not canonical yet, they are canonicalized
+		 * by the manager.
+		 */
+		transform::resize_request_key_t m_key;
+		//! Should the transformed image be kept in the cache permanently?
+		bool m_pinned;
+		//! Should the requested size be rounded up to the ladder of sizes?
+		bool m_quantize;
+	};
+
+	//! An image from a batch of renditions.
+	struct rendition_batch_item_t
+	{
+		//! URL of the image from the request.
+		std::string m_url;
+		//! The requested image.
+		requested_image_t m_image;
+		//! Is the source image known to be absent?
+		/*!
+		 * The image gets 404 status without bothering workers.
+		 */
+		bool m_missing;
+		//! Slot of the image in the limit of active requests.
+		/*!
+		 * Every image of a batch takes its own slot.
+		 */
+		active_request_guard_t m_active_request;
+	};
+
+	//! A request for several images at once.
+	/*!
+	 * \note This message must be sent as a mutable message.
+	 */
+	struct rendition_batch_request_t final : public so_5::message_t
+	{
+		//! Original HTTP-request.
+		restinio::request_handle_t m_http_req;
+		//! Requested images.
+		std::vector< rendition_batch_item_t > m_items;
+		//! Context of the server which received the request.
+		restinio::asio_ns::io_context * m_io_context;
+
+		rendition_batch_request_t(
+			restinio::request_handle_t http_req,
+			std::vector< rendition_batch_item_t > items,
+			restinio::asio_ns::io_context * io_context )
+			: m_http_req{ std::move(http_req) }
+			, m_items{ std::move(items) }
+			, m_io_context{ io_context }
 		{}
 	};
 
@@ -83,6 +254,22 @@ public:
 		std::chrono::microseconds m_resize_duration;
 		//! Time spent on image encoding to the target format.
 		std::chrono::microseconds m_encoding_duration;
+		//! Information about the source image.
+		/*!
+		 * Is empty if the source image wasn't decoded in its full size.
+		 */
+		std::optional< source_image_info_t > m_source_info;
+	};
+
+	//! Kind of transformation failure.
+	enum class failure_reason_t
+	{
+		//! Source image can't be read or decoded.
+		source_failure,
+		//! Source image can't be transformed (too big result, for example).
+		transform_failure,
+		//! Transformed image can't be encoded into the target format.
+		encoding_failure
 	};
 
 	//! Description of failed transformation result.
@@ -90,6 +277,8 @@ public:
 	{
 		//! Textual description of a failure.
 		std::string m_reason;
+		//! Kind of the failure.
+		failure_reason_t m_reason_code;
 	};
 
 	//! Message with result of image transformation.
@@ -119,28 +308,218 @@ public:
 		{}
 	};
 	
+	//! Message with result of reading of a source image in advance.
+	struct prefetch_result_t final : public so_5::message_t
+	{
+		//! Path to the source image.
+		const std::string m_path;
+		//! Content of the source image.
+		/*!
+		 * Is empty if the source image can't be read.
+		 */
+		const source_content_shared_ptr_t m_source;
+
+		prefetch_result_t(
+			std::string path,
+			source_content_shared_ptr_t source )
+			: m_path{ std::move(path) }
+			, m_source{ std::move(source) }
+		{}
+	};
+
+	//! Notification about changed or removed source images.
+	struct source_changed_t final : public so_5::message_t
+	{
+		//! Path to the source image or to the directory (from the root
+		//! of the storage, starts with '/').
+		const std::string m_path;
+		//! Is the whole directory changed?
+		/*!
+		 * If true all images inside \a m_path (including subdirectories)
+		 * must be treated as changed.
+		 */
+		const bool m_is_directory;
+
+		source_changed_t( std::string path, bool is_directory )
+			: m_path{ std::move(path) }
+			, m_is_directory{ is_directory }
+		{}
+	};
+
 	//! A request for cleaning the cache of transformed image.
 	/*!
+	 * Only images for specific source images can be removed.
+	 *
 	 * \note This message must be sent as a mutable message.
 	 */
 	struct delete_cache_request_t final : public so_5::message_t
 	{
+		//! How images to be removed are selected.
+		enum class selector_t
+		{
+			//! All images must be removed.
+			all,
+			//! Images for the source image with the exact path.
+			path,
+			//! Images for source images with paths with the prefix.
+			prefix,
+			//! Images for source images with paths matched by
+			//! a shell wildcard pattern (see fnmatch(3)).
+			glob
+		};
+
 		//! Original HTTP-request.
 		restinio::request_handle_t m_http_req;
 		//! Value of access-token to be checked.
 		std::string m_token;
+		//! How images to be removed are selected.
+		selector_t m_selector;
+		//! Path, prefix or pattern. Starts with '/'.
+		/*!
+		 * Is empty for selector_t::all.
+		 */
+		std::string m_pattern;
 
 		delete_cache_request_t(
 			restinio::request_handle_t http_req,
-			std::string token )
+			std::string token,
+			selector_t selector,
+			std::string pattern )
 			: m_http_req{ std::move(http_req) }
 			, m_token{ std::move(token) }
+			, m_selector{ selector }
+			, m_pattern{ std::move(pattern) }
+		{}
+	};
+
+	//! A request for information about a source image.
+	/*!
+	 * The header of the source image is read by the source reader
+	 * agent, the request is sent back by image_info_read_t message.
+	 *
+	 * \note This message must be sent as a mutable message.
+	 */
+	struct image_info_request_t final : public so_5::message_t
+	{
+		//! Original HTTP-request.
+		restinio::request_handle_t m_http_req;
+		//! Path to the source image.
+		std::string m_path;
+		//! Context of the server which received the request.
+		restinio::asio_ns::io_context * m_io_context;
+		//! Stat-information of the source file.
+		/*!
+		 * Is set by the source reader agent.
+		 */
+		std::optional< source_file_stat_t > m_stat;
+		//! Information from the header of the source image.
+		/*!
+		 * Is set by the source reader agent. Is empty if the source
+		 * image can't be read.
+		 */
+		std::optional< source_image_info_t > m_info;
+
+		image_info_request_t(
+			restinio::request_handle_t http_req,
+			std::string path,
+			restinio::asio_ns::io_context * io_context )
+			: m_http_req{ std::move(http_req) }
+			, m_path{ std::move(path) }
+			, m_io_context{ io_context }
+		{}
+	};
+
+	//! Message with a request for information about a source image
+	//! after the reading of the header of the image.
+	struct image_info_read_t final : public so_5::message_t
+	{
+		const sobj_shptr_t< image_info_request_t > m_request;
+
+		image_info_read_t(
+			sobj_shptr_t< image_info_request_t > request )
+			: m_request{ std::move(request) }
+		{}
+	};
+
+	//! A request for a tiny placeholder of an image.
+	/*!
+	 * \note This message must be sent as a mutable message.
+	 */
+	struct placeholder_request_t final : public so_5::message_t
+	{
+		//! Original HTTP-request.
+		restinio::request_handle_t m_http_req;
+		//! Path to the source image.
+		std::string m_path;
+		//! Slot of the request in the limit of active requests.
+		active_request_guard_t m_active_request;
+		//! Context of the server which received the request.
+		restinio::asio_ns::io_context * m_io_context;
+
+		placeholder_request_t(
+			restinio::request_handle_t http_req,
+			std::string path,
+			active_request_guard_t active_request,
+			restinio::asio_ns::io_context * io_context )
+			: m_http_req{ std::move(http_req) }
+			, m_path{ std::move(path) }
+			, m_active_request{ std::move(active_request) }
+			, m_io_context{ io_context }
+		{}
+	};
+
+	//! A request for transformation of images in advance.
+	/*!
+	 * \note This message must be sent as a mutable message.
+	 */
+	struct prewarm_request_t final : public so_5::message_t
+	{
+		//! Original HTTP-request.
+		restinio::request_handle_t m_http_req;
+		//! Value of access-token to be checked.
+		std::string m_token;
+		//! Images to be transformed.
+		std::vector<requested_image_t> m_images;
+
+		prewarm_request_t(
+			restinio::request_handle_t http_req,
+			std::string token,
+			std::vector<requested_image_t> images )
+			: m_http_req{ std::move(http_req) }
+			, m_token{ std::move(token) }
+			, m_images{ std::move(images) }
+		{}
+	};
+
+	//! A request for the status of a prewarm batch.
+	/*!
+	 * \note This message must be sent as a mutable message.
+	 */
+	struct prewarm_status_request_t final : public so_5::message_t
+	{
+		//! Original HTTP-request.
+		restinio::request_handle_t m_http_req;
+		//! Value of access-token to be checked.
+		std::string m_token;
+		//! ID of the batch.
+		std::uint64_t m_batch_id;
+
+		prewarm_status_request_t(
+			restinio::request_handle_t http_req,
+			std::string token,
+			std::uint64_t batch_id )
+			: m_http_req{ std::move(http_req) }
+			, m_token{ std::move(token) }
+			, m_batch_id{ batch_id }
 		{}
 	};
 
 	a_transform_manager_t(
 		context_t ctx,
-		std::shared_ptr<spdlog::logger> logger );
+		std::shared_ptr<spdlog::logger> logger,
+		transform_manager_params_t params,
+		transform_params_t transform_params,
+		source_files_shared_ptr_t source_files );
 
 	virtual void
 	so_define_agent() override;
@@ -156,20 +535,41 @@ public:
 	void
 	add_worker( so_5::mbox_t worker );
 
+	//! Set a mbox of source prefetcher agent.
+	/*!
+	 * This method must be called before the registration of
+	 * cooperation with transformer manager agent.
+	 *
+	 * Source images are not read in advance if there is no prefetcher.
+	 */
+	void
+	set_prefetcher( so_5::mbox_t prefetcher );
+
+	//! Set a mbox of source reader agent.
+	/*!
+	 * This method must be called before the registration of
+	 * cooperation with transformer manager agent.
+	 *
+	 * Headers of source images for information requests are read
+	 * by that agent, not by the manager or the HTTP server.
+	 */
+	void
+	set_source_reader( so_5::mbox_t source_reader );
+
 private :
 	//! A delayed message to send a negative response for
-	//! delete cache request.
+	//! admin request (delete cache, prewarm and so on).
 	/*!
 	 * \note This message must be sent as a mutable message.
 	 */
-	struct negative_delete_cache_response_t : public so_5::message_t
+	struct negative_admin_response_t : public so_5::message_t
 	{
 		//! Original HTTP-request.
 		restinio::request_handle_t m_http_req;
 		//! Description for request.
 		std::string m_response_text;
 
-		negative_delete_cache_response_t(
+		negative_admin_response_t(
 			restinio::request_handle_t http_req,
 			std::string response_text )
 			: m_http_req{ std::move(http_req) }
@@ -182,6 +582,81 @@ private :
 			transform::resize_request_key_t,
 			datasizable_blob_shared_ptr_t >;
 
+	//! Cache of processed images with the amount of occupied memory.
+	/*!
+	 * Different keys can produce identical images. Only one copy of
+	 * such image is stored, all keys refer to it.
+	 */
+	class images_cache_t
+	{
+	public:
+		//! Processed images.
+		cache_t m_images;
+		//! Total amount of memory occuped by unique processed images.
+		std::uint_fast64_t m_memory_size{ 0u };
+
+		//! Amount of memory which will be occupied by an image if
+		//! it is added to the cache.
+		[[nodiscard]] std::size_t
+		memory_size_for( const datasizable_blob_t & blob ) const;
+
+		//! Add an image to the cache.
+		/*!
+		 * If an identical image is already in the cache then it is reused.
+		 */
+		void
+		insert(
+			transform::resize_request_key_t key,
+			datasizable_blob_shared_ptr_t blob );
+
+		void
+		erase( cache_t::access_token_t atoken );
+
+		void
+		clear();
+
+	private:
+		//! An image stored in the cache with count of keys which refer to it.
+		struct unique_blob_t
+		{
+			datasizable_blob_shared_ptr_t m_blob;
+			std::size_t m_references;
+		};
+
+		//! Unique images by hashes of their content.
+		std::unordered_map< std::uint64_t, unique_blob_t > m_unique_blobs;
+
+		[[nodiscard]] const unique_blob_t *
+		find_identical( const datasizable_blob_t & blob ) const;
+	};
+
+	//! Type of container for placeholders of images.
+	/*!
+	 * Key is the path to the source image, value is the data URI
+	 * of the placeholder.
+	 */
+	using placeholders_cache_t = cache_alike_container_t<
+			std::string,
+			std::string >;
+
+	//! Type of container for information about source images.
+	/*!
+	 * Key is the path to the source image.
+	 */
+	using source_infos_t = cache_alike_container_t<
+			std::string,
+			source_image_info_t >;
+
+	//! Type of container for recently failed transformations.
+	using failed_keys_cache_t = cache_alike_container_t<
+			transform::resize_request_key_t,
+			failure_reason_t >;
+
+	//! Type of container for recently failed source images.
+	using failed_sources_cache_t = cache_alike_container_t<
+			std::string,
+			failure_reason_t >;
+
 	//! Type of container for pending and inprogress requests.
 	using pending_request_queue_t = key_multivalue_queue_t<
 			transform::resize_request_key_t,
@@ -194,6 +669,63 @@ private :
 	//! Type of container with free workers.
 	using free_worker_container_t = std::stack<so_5::mbox_t>;
 
+	//! Type of container for source images read in advance.
+	using prefetched_sources_t = cache_alike_container_t<
+			std::string,
+			source_content_shared_ptr_t >;
+
+	//! Type of container for source images which are being read.
+	using inflight_prefetches_t = std::set<std::string>;
+
+	//! Type of container for requests made from outdated sources.
+	using outdated_keys_t = std::set<transform::resize_request_key_t>;
+
+	//! Progress of a prewarm batch.
+	struct prewarm_batch_t
+	{
+		//! Count of images in the batch.
+		std::size_t m_total{ 0u };
+		//! Count of images waiting for a free worker.
+		std::size_t m_queued{ 0u };
+		//! Count of images being transformed now.
+		std::size_t m_inprogress{ 0u };
+		//! Count of images transformed successfully.
+		std::size_t m_transformed{ 0u };
+		//! Count of images already present in the cache (or being
+		//! transformed for someone else).
+		std::size_t m_skipped{ 0u };
+		//! Count of images which can't be transformed.
+		std::size_t m_failed{ 0u };
+
+		[[nodiscard]] bool
+		finished() const noexcept
+		{
+			return 0u == m_queued && 0u == m_inprogress;
+		}
+	};
+
+	//! Type of container for prewarm batches.
+	using prewarm_batches_t = std::map<std::uint64_t, prewarm_batch_t>;
+
+	//! Type of queue of images to be transformed in advance.
+	using prewarm_queue_t = std::deque<
+			std::pair<std::uint64_t, requested_image_t> >;
+
+	//! An image being transformed in advance.
+	struct prewarm_inprogress_item_t
+	{
+		//! ID of the batch.
+		std::uint64_t m_batch_id;
+		//! Should the image be stored in the pinned cache?
+		bool m_pinned;
+	};
+
+	//! Type of container for images being transformed in advance.
+	using prewarm_inprogress_t = std::map<
+			transform::resize_request_key_t,
+			prewarm_inprogress_item_t,
+			std::less<> >;
+
 	//! A special signal to remove oldest images from the cache.
 	struct clear_cache_t final : public so_5::signal_t {};
 
@@ -203,15 +735,56 @@ private :
 	//! Personal logger for this agent.
 	std::shared_ptr<spdlog::logger> m_logger;
 
+	//! Configuration for agent.
+	const transform_manager_params_t m_params;
+
+	//! Parameters of transformations.
+	const transform_params_t m_transform_params;
+
+	//! Access to source images.
+	/*!
+	 * Source images which are sent as is are opened on the context
+	 * of the server, not on the manager's thread.
+	 */
+	const source_files_shared_ptr_t m_source_files;
+
 	//! Cache of processed images.
-	cache_t m_transformed_cache;
+	images_cache_t m_transformed_cache;
+
+	//! Cache of images for pinned presets.
+	images_cache_t m_pinned_cache;
+
+	//! Count of requests with sizes rounded up to the ladder of sizes
+	//! since the last report.
+	std::uint_fast64_t m_quantized_requests{ 0u };
 
-	//! Total amount of memory occuped by processed images.
-	std::uint_fast64_t m_transformed_cache_memory_size{ 0u };
 	//! Max size of cache of transformed images.
 	static constexpr std::uint_fast64_t max_transformed_cache_memory_size{
 			100ul * 1024ul * 1024ul };
 
+	//! Placeholders of images.
+	placeholders_cache_t m_placeholders;
+	//! Max count of placeholders in the cache.
+	static constexpr std::size_t max_placeholders{ 16u * 1024u };
+	//! Size of the longest side of a placeholder.
+	static constexpr std::uint32_t placeholder_max_side{ 16u };
+	//! Quality of a placeholder.
+	static constexpr std::uint32_t placeholder_quality{ 35u };
+
+	//! Information about source images decoded by workers.
+	/*!
+	 * It is used for the canonicalization of requests without any
+	 * access to the file system from the manager's thread.
+	 */
+	source_infos_t m_source_infos;
+	//! Max count of source images information about that is stored.
+	static constexpr std::size_t max_source_infos{ 64u * 1024u };
+
+	//! Recently failed transformations.
+	failed_keys_cache_t m_failed_keys;
+	//! Recently failed source images.
+	failed_sources_cache_t m_failed_sources;
+
 	//! Queue of pending requests.
 	pending_request_queue_t m_pending_requests;
 	//! Max count of pending requests.
@@ -222,13 +795,64 @@ private :
 
 	//! Container of free workers.
 	free_worker_container_t m_free_workers;
+	//! Total count of workers.
+	std::size_t m_workers_count{ 0u };
+
+	//! Mbox of source prefetcher agent.
+	/*!
+	 * Is empty if source images are not read in advance.
+	 */
+	so_5::mbox_t m_prefetcher;
+
+	//! Mbox of source reader agent.
+	so_5::mbox_t m_source_reader;
+
+	//! Source images which are being read in advance now.
+	inflight_prefetches_t m_inflight_prefetches;
+
+	//! Source images already read in advance.
+	prefetched_sources_t m_prefetched_sources;
+
+	//! Source images which were changed while they were being read.
+	/*!
+	 * Results of reading of those images must be ignored.
+	 */
+	inflight_prefetches_t m_outdated_prefetches;
+
+	//! Requests in progress for sources which were changed.
+	/*!
+	 * Results of those requests must not be stored in the cache.
+	 */
+	outdated_keys_t m_outdated_inprogress_keys;
+
+	//! Known prewarm batches.
+	prewarm_batches_t m_prewarm_batches;
+	//! ID of the last prewarm batch.
+	std::uint64_t m_last_prewarm_batch_id{ 0u };
+	//! Max count of known prewarm batches.
+	/*!
+	 * Finished batches are forgotten when this limit is reached.
+	 */
+	static constexpr std::size_t max_prewarm_batches{ 64u };
+
+	//! Images to be transformed in advance.
+	prewarm_queue_t m_prewarm_queue;
+	//! Max count of images to be transformed in advance.
+	static constexpr std::size_t max_prewarm_queue_size{ 10000u };
+
+	//! Images being transformed in advance now.
+	prewarm_inprogress_t m_prewarm_inprogress;
+
+	//! Time of the last request from a client.
+	std::chrono::steady_clock::time_point m_last_client_request_at{};
+	//! Pause in requests from clients after that the only worker
+	//! can be used for prewarm.
+	static constexpr std::chrono::seconds prewarm_quiet_period{ 5 };
 
 	//! Timer for clear_cache operation.
 	so_5::timer_id_t m_clear_cache_timer;
 	//! Interval for clear cache operations.
 	static constexpr std::chrono::minutes clear_cache_period{ 1 };
-	//! Max time of storing an image in the cache.
-	static constexpr std::chrono::hours max_cache_lifetime{ 1 };
 
 	//! Timer for checking pending requests.
 	so_5::timer_id_t m_check_pending_timer;
@@ -241,17 +865,60 @@ private :
 	on_resize_request(
 		mutable_mhood_t<resize_request_t> cmd );
 
+	void
+	on_rendition_batch_request(
+		mutable_mhood_t<rendition_batch_request_t> cmd );
+
+	void
+	on_image_info_request(
+		mutable_mhood_t<image_info_request_t> cmd );
+
+	void
+	on_image_info_read(
+		mhood_t<image_info_read_t> cmd );
+
+	void
+	on_placeholder_request(
+		mutable_mhood_t<placeholder_request_t> cmd );
+
 	void
 	on_resize_result(
 		mutable_mhood_t<resize_result_t> cmd );
 
+	void
+	on_prefetch_result(
+		mhood_t<prefetch_result_t> cmd );
+
+	void
+	on_source_changed(
+		mhood_t<source_changed_t> cmd );
+
 	void
 	on_delete_cache_request(
 		mutable_mhood_t<delete_cache_request_t> cmd );
 
 	void
-	on_negative_delete_cache_response(
-		mutable_mhood_t<negative_delete_cache_response_t> cmd );
+	on_prewarm_request(
+		mutable_mhood_t<prewarm_request_t> cmd );
+
+	void
+	on_prewarm_status_request(
+		mutable_mhood_t<prewarm_status_request_t> cmd );
+
+	void
+	on_negative_admin_response(
+		mutable_mhood_t<negative_admin_response_t> cmd );
+
+	//! Check the access-token of an admin request.
+	/*!
+	 * A negative response is sent with a delay if the token is invalid.
+	 *
+	 * \return true if the token is valid.
+	 */
+	[[nodiscard]] bool
+	check_admin_token(
+		restinio::request_handle_t & http_req,
+		const std::string & token );
 
 	void
 	on_clear_cache(
@@ -261,24 +928,133 @@ private :
 	on_check_pending_requests(
 		mhood_t<check_pending_requests_t> );
 
+	//! Get information about a source image if it is known.
+	[[nodiscard]] std::optional< source_image_info_t >
+	known_source_info( const std::string & path );
+
+	//! Make canonical parameters from parameters from the client.
+	/*!
+	 * The size is rounded up to the ladder of sizes (if necessary) and
+	 * canonicalized if the size of the source image is known.
+	 */
+	[[nodiscard]] transform::resize_params_t
+	make_canonical_params(
+		const std::optional< source_image_info_t > & info,
+		const transform::resize_params_t & params,
+		bool quantize ) const;
+
+	//! Make a key with canonical parameters for a requested image.
+	[[nodiscard]] transform::resize_request_key_t
+	make_canonical_key( const requested_image_t & image );
+
+	//! Replace parameters from the client by the canonical ones.
+	/*!
+	 * \return true if the source image can be sent as is.
+	 */
+	[[nodiscard]] bool
+	canonicalize_request( resize_request_t & request );
+
+	//! Store information about a source image.
+	void
+	store_source_info( std::string path, const source_image_info_t & info );
+
+	//! Make a key for the transformation of an image to its placeholder.
+	[[nodiscard]] static transform::resize_request_key_t
+	make_placeholder_key( std::string path );
+
+	//! Store a placeholder into the cache.
+	void
+	store_placeholder_to_cache( std::string path, std::string data_uri );
+
+	//! Send a placeholder as a response to a request.
+	static void
+	send_placeholder( sobj_shptr_t<resize_request_t> request, std::string data_uri );
+
+	//! Serve a request from a cache or pass it to a worker.
+	void
+	handle_resize_request(
+		transform::resize_request_key_t request_key,
+		sobj_shptr_t<resize_request_t> request );
+
+	//! Store the result for an image into its batch.
+	/*!
+	 * The response for the batch is sent if it was the last image.
+	 */
+	void
+	complete_batch_item(
+		resize_request_t & request,
+		std::uint16_t status,
+		datasizable_blob_shared_ptr_t blob = {} );
+
+	//! Send a negative response for a request.
+	/*!
+	 * If the request belongs to a batch then only the status is stored.
+	 */
+	void
+	send_negative_response(
+		sobj_shptr_t<resize_request_t> request,
+		std::uint16_t status );
+
 	void
 	handle_request_for_already_transformed_image(
 		sobj_shptr_t<resize_request_t> cmd,
+		images_cache_t & cache,
 		cache_t::access_token_t atoken );
 
+	//! Is there an image in any of caches?
+	[[nodiscard]] bool
+	is_cached( const transform::resize_request_key_t & key );
+
+	//! Check that the same transformation failed recently.
+	[[nodiscard]] bool
+	has_known_failure(
+		const transform::resize_request_key_t & key );
+
+	//! Reject a request if the same transformation failed recently.
+	/*!
+	 * \return true if the request was rejected.
+	 */
+	[[nodiscard]] bool
+	try_reject_known_failure(
+		const transform::resize_request_key_t & key,
+		sobj_shptr_t<resize_request_t> & cmd );
+
 	void
 	handle_not_transformed_image(
 		transform::resize_request_key_t key,
 		sobj_shptr_t<resize_request_t> cmd );
 
+	void
+	try_initiate_prefetch( const std::string & path );
+
 	void
 	try_initiate_pending_requests_processing();
 
+	void
+	try_initiate_prewarm_processing();
+
+	//! Update progress of a prewarm batch if the image was
+	//! transformed in advance.
+	/*!
+	 * \return true if the image was requested by a prewarm batch
+	 * for a pinned preset.
+	 */
+	[[nodiscard]] bool
+	handle_prewarm_result(
+		const transform::resize_request_key_t & key,
+		bool successful );
+
+	//! Forget some finished prewarm batches if there are too many batches.
+	void
+	remove_finished_prewarm_batches();
+
 	void
 	on_successful_resize(
 		transform::resize_request_key_t key,
 		successful_resize_t & result,
-		original_request_container_t requests );
+		original_request_container_t requests,
+		//! Was the image requested by a prewarm batch for a pinned preset?
+		bool pinned_prewarm );
 
 	void
 	on_failed_resize(
@@ -286,11 +1062,57 @@ private :
 		failed_resize_t & result,
 		original_request_container_t requests );
 
+	void
+	store_failure_to_cache(
+		const transform::resize_request_key_t & key,
+		failure_reason_t reason );
+
+	void
+	remove_expired_failures();
+
 	void
 	store_transformed_image_to_cache(
+		transform::resize_request_key_t key,
+		datasizable_blob_shared_ptr_t image_blob,
+		bool pinned );
+
+	//! Try to store an image for a pinned preset into the pinned cache.
+	/*!
+	 * \return false if there is no space in the pinned cache.
+	 */
+	[[nodiscard]] bool
+	try_store_image_to_pinned_cache(
 		transform::resize_request_key_t key,
 		datasizable_blob_shared_ptr_t image_blob );
 
+	void
+	remove_image_from_cache(
+		images_cache_t & cache,
+		cache_t::access_token_t atoken );
+
+	void
+	remove_all_images_from_cache( images_cache_t & cache );
+
+	//! Remove placeholders selected by delete cache request.
+	/*!
+	 * \return count of removed placeholders.
+	 */
+	std::size_t
+	remove_selected_placeholders( const delete_cache_request_t & request );
+
+	//! Description of images removed from the cache.
+	struct removed_images_t
+	{
+		std::size_t m_count{ 0u };
+		std::uint_fast64_t m_bytes{ 0u };
+	};
+
+	//! Remove images selected by delete cache request.
+	removed_images_t
+	remove_selected_images_from_cache(
+		images_cache_t & cache,
+		const delete_cache_request_t & request );
+
 	[[nodiscard]]
 	original_request_container_t
 	extract_inprogress_requests(
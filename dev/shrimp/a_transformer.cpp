@@ -10,6 +10,9 @@
 #include <cassert>
 
 #include <shrimp/a_transformer.hpp>
+#include <shrimp/magick_utils.hpp>
+
+using namespace std::literals;
 
 namespace shrimp {
 
@@ -19,10 +22,12 @@ namespace shrimp {
 a_transformer_t::a_transformer_t(
 	context_t ctx,
 	std::shared_ptr<spdlog::logger> logger,
-	storage_params_t cfg )
+	source_files_shared_ptr_t source_files,
+	bool allow_upscale )
 	: so_5::agent_t{ std::move(ctx) }
 	, m_logger{ std::move(logger) }
-	, m_cfg{ std::move(cfg) }
+	, m_source_files{ std::move(source_files) }
+	, m_allow_upscale{ allow_upscale }
 {}
 
 void
@@ -36,7 +41,9 @@ void
 a_transformer_t::on_resize_request(
 	mutable_mhood_t<resize_request_t> cmd)
 {
-	auto result = handle_resize_request( cmd->m_key );
+	auto result = handle_resize_request(
+			cmd->m_key,
+			std::move(cmd->m_source) );
 
 	so_5::send< so_5::mutable_msg<a_transform_manager_t::resize_result_t> >(
 			cmd->m_reply_to,
@@ -66,27 +73,109 @@ magick_from_image_format( image_format_t fmt )
 	return r;
 }
 
+//! Decode an image from a memory block without copying it.
+/*!
+ * Name of the image is used as a hint for detection of image format.
+ */
+[[nodiscard]] Magick::Image
+decode_image(
+	std::string_view image_name,
+	const void * data,
+	std::size_t size,
+	//! Min size of sides for scaling during decoding. 0 means no scaling.
+	std::uint32_t size_hint )
+{
+	auto exception = magick::make_exception_info();
+	magick::image_info_unique_ptr_t image_info{
+			MagickCore::AcquireImageInfo() };
+
+	const std::string filename{ image_name };
+	MagickCore::CopyMagickString(
+			image_info->filename,
+			filename.c_str(),
+			MagickPathExtent );
+
+	if( size_hint )
+	{
+		// Only JPEG decoder uses this hint.
+		const auto hint = fmt::format( "{0}x{0}", size_hint );
+		MagickCore::SetImageOption( image_info.get(), "jpeg:size", hint.c_str() );
+	}
+
+	auto * decoded = MagickCore::BlobToImage(
+			image_info.get(), data, size, exception.get() );
+	if( !decoded )
+	{
+		Magick::throwException( exception.get() );
+		throw exception_t{ "unable to decode image: {}", image_name };
+	}
+
+	// Magick::Image takes the ownership of the decoded image,
+	// so it will be destroyed even if an exception is thrown below.
+	Magick::Image image{ decoded };
+	Magick::throwException( exception.get(), image.quiet() );
+
+	return image;
+}
+
+//! Get information about a decoded image.
+/*!
+ * \return empty value if the format of the image isn't supported.
+ */
+[[nodiscard]] std::optional< source_image_info_t >
+image_info_of( const Magick::Image & image )
+{
+	const auto format = image_format_from_magick( image.magick() );
+	if( !format )
+		return std::nullopt;
+
+	return source_image_info_t{
+			*format,
+			static_cast< std::uint32_t >( image.columns() ),
+			static_cast< std::uint32_t >( image.rows() ) };
+}
+
 } /* namespace anonymous */
 
 [[nodiscard]]
 a_transform_manager_t::resize_result_t::result_t
 a_transformer_t::handle_resize_request(
-	const transform::resize_request_key_t & key )
+	const transform::resize_request_key_t & key,
+	source_content_shared_ptr_t source )
 {
+	using failure_reason_t = a_transform_manager_t::failure_reason_t;
+
+	// The stage of processing for the case of a failure.
+	auto stage = failure_reason_t::source_failure;
 	try
 	{
 		m_logger->trace( "transformation started; request_key={}", key );
 
-		auto image = load_image( key.path() );
+		// A placeholder is made from the twice bigger image,
+		// the quality of such downscale is enough for it.
+		std::uint32_t size_hint{ 0u };
+		if( key.placeholder() &&
+				transform::resize_params_t::mode_t::keep_original !=
+				key.params().mode() )
+			size_hint = key.params().value() * 2u;
+
+		auto image = load_image( key.path(), std::move(source), size_hint );
+		const auto source_info = image_info_of( image );
 
+		stage = failure_reason_t::transform_failure;
 		const auto resize_duration = measure_duration( [&]{
+				const auto params = transform::canonicalize_resize_params(
+						image.size(),
+						key.params(),
+						m_allow_upscale );
+
 				// Actual resize operation is necessary if
 				// keep_original mode is not used.
 				if( transform::resize_params_t::mode_t::keep_original !=
-						key.params().mode() )
+						params.mode() )
 				{
 					transform::resize(
-							key.params(),
+							params,
 							total_pixel_count,
 							image );
 				}
@@ -96,7 +185,12 @@ a_transformer_t::handle_resize_request(
 				std::chrono::duration_cast<std::chrono::milliseconds>(
 						resize_duration).count() );
 
+		stage = failure_reason_t::encoding_failure;
 		image.magick( magick_from_image_format( key.format() ) );
+		if( key.placeholder() )
+			image.strip();
+		if( key.quality() )
+			image.quality( key.quality() );
 
 		datasizable_blob_shared_ptr_t blob;
 		const auto serialize_duration = measure_duration( [&] {
@@ -112,20 +206,39 @@ a_transformer_t::handle_resize_request(
 				std::chrono::duration_cast<std::chrono::microseconds>(
 						resize_duration),
 				std::chrono::duration_cast<std::chrono::microseconds>(
-						serialize_duration) };
+						serialize_duration),
+				// The manager uses the size of the source for
+				// the canonicalization of next requests.
+				size_hint ? std::nullopt : source_info };
 	}
 	catch( const std::exception & x )
 	{
-		return a_transform_manager_t::failed_resize_t{ x.what() };
+		return a_transform_manager_t::failed_resize_t{ x.what(), stage };
 	}
 }
 
 [[nodiscard]]
 Magick::Image
-a_transformer_t::load_image( std::string_view image_name ) const
+a_transformer_t::load_image(
+	std::string_view image_name,
+	source_content_shared_ptr_t source,
+	std::uint32_t size_hint ) const
 {
-	Magick::Image image;
-	image.read( make_full_path( m_cfg.m_root_dir, image_name ) );
+	if( !source )
+		source = m_source_files->read( image_name );
+
+	auto image = decode_image(
+			image_name, source->data(), source->size(), size_hint );
+
+	// The size of a scaled image isn't the size of the source.
+	if( size_hint )
+		return image;
+
+	if( const auto info = image_info_of( image ) )
+		m_source_files->remember_image_info(
+				image_name,
+				source->stat(),
+				*info );
 
 	return image;
 }
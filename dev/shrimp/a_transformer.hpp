@@ -10,7 +10,7 @@
 #pragma once
 
 #include <shrimp/a_transform_manager.hpp>
-#include <shrimp/app_params.hpp>
+#include <shrimp/source_files.hpp>
 
 #include <spdlog/spdlog.h>
 
@@ -36,13 +36,20 @@ public:
 	{
 		//! Original request to be processed.
 		transform::resize_request_key_t m_key;
+		//! Content of the source image if it was read in advance.
+		/*!
+		 * Is empty if source image wasn't read yet.
+		 */
+		source_content_shared_ptr_t m_source;
 		//! Mbox for the result of the transformation.
 		const so_5::mbox_t m_reply_to;
 
 		resize_request_t(
 			transform::resize_request_key_t key,
+			source_content_shared_ptr_t source,
 			so_5::mbox_t reply_to )
 			: m_key{ std::move(key) }
+			, m_source{ std::move(source) }
 			, m_reply_to{ std::move(reply_to) }
 		{}
 	};
@@ -50,7 +57,8 @@ public:
 	a_transformer_t(
 		context_t ctx,
 		std::shared_ptr<spdlog::logger> logger,
-		storage_params_t cfg );
+		source_files_shared_ptr_t source_files,
+		bool allow_upscale );
 
 	virtual void
 	so_define_agent() override;
@@ -62,8 +70,11 @@ private:
 	//! Personal logger for this agent.
 	std::shared_ptr<spdlog::logger> m_logger;
 
-	//! Configuration for agent.
-	const storage_params_t m_cfg;
+	//! Access to source images.
+	const source_files_shared_ptr_t m_source_files;
+
+	//! Can images be enlarged?
+	const bool m_allow_upscale;
 
 	void
 	on_resize_request(
@@ -72,12 +83,28 @@ private:
 	[[nodiscard]]
 	a_transform_manager_t::resize_result_t::result_t
 	handle_resize_request(
-		const transform::resize_request_key_t & key );
+		const transform::resize_request_key_t & key,
+		source_content_shared_ptr_t source );
 
 	//! Load image from given path.
+	/*!
+	 * Image is decoded directly from the content of the source file.
+	 * If the source wasn't read in advance it is read now.
+	 *
+	 * Information about the decoded image is stored in source_files
+	 * for canonicalization of subsequent requests.
+	 *
+	 * If \a size_hint is not zero then the decoder can produce a smaller
+	 * image, but not smaller than \a size_hint on both sides (JPEG
+	 * images are scaled during decoding). Information about the image
+	 * isn't stored in that case.
+	 */
 	[[nodiscard]]
 	Magick::Image
-	load_image( std::string_view image_name ) const;
+	load_image(
+		std::string_view image_name,
+		source_content_shared_ptr_t source,
+		std::uint32_t size_hint = 0u ) const;
 };
 
 } /* namespace shrimp */
@@ -0,0 +1,132 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Limit for count of requests being handled by the manager.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace shrimp {
+
+class active_requests_limiter_t;
+
+//
+// active_request_guard_t
+//
+
+//! A slot of an active request.
+/*!
+ * The slot is released when the guard is destroyed. The guard is
+ * stored in the message for the manager, so the slot is held until
+ * the request is answered.
+ *
+ * Default constructed guard doesn't hold a slot.
+ *
+ * \note This is Moveable type, not Copyable.
+ */
+class active_request_guard_t
+{
+	friend class active_requests_limiter_t;
+
+	explicit active_request_guard_t(
+		std::shared_ptr< active_requests_limiter_t > limiter ) noexcept
+		:	m_limiter{ std::move(limiter) }
+	{}
+
+public:
+	active_request_guard_t() = default;
+
+	active_request_guard_t( const active_request_guard_t & ) = delete;
+	active_request_guard_t &
+	operator=( const active_request_guard_t & ) = delete;
+
+	active_request_guard_t( active_request_guard_t && ) noexcept = default;
+
+	active_request_guard_t &
+	operator=( active_request_guard_t && o ) noexcept
+	{
+		active_request_guard_t tmp{ std::move(o) };
+		std::swap( m_limiter, tmp.m_limiter );
+		return *this;
+	}
+
+	inline ~active_request_guard_t();
+
+private:
+	std::shared_ptr< active_requests_limiter_t > m_limiter;
+};
+
+//
+// active_requests_limiter_t
+//
+
+//! Limiter for count of requests which are being handled.
+/*!
+ * If there are too many active requests then the manager is overloaded
+ * and new requests are rejected without bothering it.
+ *
+ * \note This class is thread-safe.
+ */
+class active_requests_limiter_t
+	:	public std::enable_shared_from_this< active_requests_limiter_t >
+{
+	friend class active_request_guard_t;
+
+public:
+	explicit active_requests_limiter_t( std::size_t max_active ) noexcept
+		:	m_max_active{ max_active }
+	{}
+
+	//! Try to take a slot for a new request.
+	/*!
+	 * \return empty value if the limit is reached.
+	 */
+	[[nodiscard]] std::optional< active_request_guard_t >
+	try_acquire()
+	{
+		auto current = m_active.load( std::memory_order_relaxed );
+		do
+		{
+			if( current >= m_max_active )
+				return std::nullopt;
+		}
+		while( !m_active.compare_exchange_weak(
+				current, current + 1u, std::memory_order_relaxed ) );
+
+		return active_request_guard_t{ shared_from_this() };
+	}
+
+	[[nodiscard]] std::size_t
+	active() const noexcept
+	{
+		return m_active.load( std::memory_order_relaxed );
+	}
+
+private:
+	void
+	release() noexcept
+	{
+		m_active.fetch_sub( 1u, std::memory_order_relaxed );
+	}
+
+	const std::size_t m_max_active;
+	std::atomic< std::size_t > m_active{ 0u };
+};
+
+inline active_request_guard_t::~active_request_guard_t()
+{
+	if( m_limiter )
+		m_limiter->release();
+}
+
+} /* namespace shrimp */
+
@@ -7,6 +7,8 @@
 #include <shrimp/http_server.hpp>
 #include <shrimp/a_transform_manager.hpp>
 #include <shrimp/a_transformer.hpp>
+#include <shrimp/a_source_prefetcher.hpp>
+#include <shrimp/a_source_watcher.hpp>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -16,8 +18,18 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/ansicolor_sink.h>
 
+#include <algorithm>
+#include <csignal>
+#include <exception>
+#include <mutex>
 #include <stdexcept>
 #include <iostream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
 
 namespace /* anonymous */
 {
@@ -117,6 +129,37 @@ struct app_args_t
 		return result;
 	}
 
+	//! Take a value from an environment variable if it is set.
+	/*!
+	 * Values from environment variables replace the defaults and
+	 * can be overridden by command-line arguments.
+	 */
+	template< typename T >
+	static void
+	apply_env_var( const char * env_var_name, T & receiver )
+	{
+		const char * var = std::getenv( env_var_name );
+		if( !var )
+			return;
+
+		try
+		{
+			if constexpr( std::is_same_v< T, bool > )
+				receiver = 0u != restinio::cast_to<unsigned int>(
+						std::string_view{ var } );
+			else
+				receiver = restinio::cast_to<T>( std::string_view{ var } );
+		}
+		catch( const std::exception & x )
+		{
+			throw shrimp::exception_t{
+					"Unable to process ENV-variable {}={}: {}",
+					env_var_name,
+					var,
+					x.what() };
+		}
+	}
+
 	[[nodiscard]]
 	static std::optional<spdlog::level::level_enum>
 	log_level_from_str( const std::string & level_name ) noexcept
@@ -151,6 +194,46 @@ struct app_args_t
 		};
 	}
 
+	[[nodiscard]]
+	static auto
+	make_preset_handler( shrimp::presets_t & receiver )
+	{
+		return [&receiver]( std::string const & v ) {
+			using namespace clara;
+			try
+			{
+				auto [name, preset] = shrimp::parse_preset( v );
+				if( !receiver.emplace( std::move(name), preset ).second )
+					return ParserResult::runtimeError(
+							"Preset is defined several times: " + v );
+
+				return ParserResult::ok( ParseResultType::Matched );
+			}
+			catch( const std::exception & x )
+			{
+				return ParserResult::runtimeError( x.what() );
+			}
+		};
+	}
+
+	[[nodiscard]]
+	static auto
+	make_cache_control_handler( shrimp::cache_control_policy_t & receiver )
+	{
+		return [&receiver]( std::string const & v ) {
+			using namespace clara;
+			try
+			{
+				receiver = shrimp::parse_cache_control_policy( v );
+				return ParserResult::ok( ParseResultType::Matched );
+			}
+			catch( const std::exception & x )
+			{
+				return ParserResult::runtimeError( x.what() );
+			}
+		};
+	}
+
 	[[nodiscard]]
 	static app_args_t
 	parse( int argc, const char * argv[] )
@@ -160,10 +243,38 @@ struct app_args_t
 		app_args_t result;
 		std::uint16_t ip_version = static_cast<std::uint16_t>(
 				result.m_app_params.m_http_server.m_ip_version);
+		auto cache_lifetime = static_cast<unsigned int>(
+				result.m_app_params.m_transform_manager.m_max_cache_lifetime.count());
+		auto negative_cache_ttl = static_cast<unsigned int>(
+				result.m_app_params.m_transform_manager.m_negative_cache_ttl.count());
+		auto pinned_cache_size_mib =
+				result.m_app_params.m_transform_manager
+						.m_max_pinned_cache_memory_size / (1024u * 1024u);
 		bool sobj_tracing = false;
 		bool restinio_tracing = false;
 		std::string log_level{ "trace" };
 
+		// Tuning of HTTP-server can also be done by environment variables.
+		auto & http_server = result.m_app_params.m_http_server;
+		auto read_timeout = static_cast<unsigned int>(
+				http_server.m_read_timeout.count());
+		auto handle_request_timeout = static_cast<unsigned int>(
+				http_server.m_handle_request_timeout.count());
+		auto write_timeout = static_cast<unsigned int>(
+				http_server.m_write_timeout.count());
+		apply_env_var( "SHRIMP_READ_TIMEOUT", read_timeout );
+		apply_env_var( "SHRIMP_HANDLE_REQUEST_TIMEOUT", handle_request_timeout );
+		apply_env_var( "SHRIMP_WRITE_TIMEOUT", write_timeout );
+		apply_env_var( "SHRIMP_READ_BUFFER_SIZE", http_server.m_buffer_size );
+		apply_env_var( "SHRIMP_MAX_PIPELINED_REQUESTS",
+				http_server.m_max_pipelined_requests );
+		apply_env_var( "SHRIMP_CONCURRENT_ACCEPTS",
+				http_server.m_concurrent_accepts );
+		apply_env_var( "SHRIMP_TCP_NODELAY", http_server.m_tcp_nodelay );
+		apply_env_var( "SHRIMP_SEND_BUFFER_SIZE", http_server.m_send_buffer_size );
+		apply_env_var( "SHRIMP_MAX_ACTIVE_REQUESTS",
+				http_server.m_max_active_requests );
+
 		std::optional<thread_count_t> io_threads;
 		std::optional<thread_count_t> worker_threads;
 
@@ -174,6 +285,13 @@ struct app_args_t
 					( fmt::format( description, val ) );
 		};
 
+		const auto make_long_opt = [](auto & val,
+				const char * name, const char * long_name,
+				const char * description) {
+			return Opt( val, name )[ long_name ]
+					( fmt::format( description, val ) );
+		};
+
 		auto cli = make_opt(
 					result.m_app_params.m_http_server.m_address, "address",
 					"-a", "--address",
@@ -182,6 +300,63 @@ struct app_args_t
 					result.m_app_params.m_http_server.m_port, "port",
 					"-p", "--port",
 					"port to listen (default: {})" )
+			| make_long_opt(
+					result.m_app_params.m_http_server.m_reuseport_servers,
+					"count",
+					"--reuseport-servers",
+					"Run that count of independent servers on the same port "
+					"with SO_REUSEPORT, each on its own thread, "
+					"0 turns this mode off (default: {})" )
+			| Opt( result.m_app_params.m_http_server.m_pin_server_threads )
+					[ "--pin-server-threads" ]
+					( "Pin threads of servers started by --reuseport-servers "
+					  "to CPU cores" )
+			| make_long_opt(
+					read_timeout, "seconds",
+					"--read-timeout",
+					"Max time for reading of a request, "
+					"env: SHRIMP_READ_TIMEOUT (default: {})" )
+			| make_long_opt(
+					handle_request_timeout, "seconds",
+					"--handle-request-timeout",
+					"Max time for handling of a request, "
+					"env: SHRIMP_HANDLE_REQUEST_TIMEOUT (default: {})" )
+			| make_long_opt(
+					write_timeout, "seconds",
+					"--write-timeout",
+					"Max time for writing of a response, "
+					"env: SHRIMP_WRITE_TIMEOUT (default: {})" )
+			| make_long_opt(
+					http_server.m_buffer_size, "bytes",
+					"--read-buffer-size",
+					"Size of the buffer for reading requests, "
+					"env: SHRIMP_READ_BUFFER_SIZE (default: {})" )
+			| make_long_opt(
+					http_server.m_max_pipelined_requests, "count",
+					"--max-pipelined-requests",
+					"Max count of pipelined requests from one connection, "
+					"env: SHRIMP_MAX_PIPELINED_REQUESTS (default: {})" )
+			| make_long_opt(
+					http_server.m_concurrent_accepts, "count",
+					"--concurrent-accepts",
+					"Count of parallel accept operations, "
+					"env: SHRIMP_CONCURRENT_ACCEPTS (default: {})" )
+			| Opt( http_server.m_tcp_nodelay )
+					[ "--tcp-nodelay" ]
+					( "Set TCP_NODELAY for connections, "
+					  "env: SHRIMP_TCP_NODELAY" )
+			| make_long_opt(
+					http_server.m_send_buffer_size, "bytes",
+					"--send-buffer-size",
+					"Size of SO_SNDBUF for connections, 0 means the system "
+					"default, env: SHRIMP_SEND_BUFFER_SIZE (default: {})" )
+			| make_long_opt(
+					http_server.m_max_active_requests, "count",
+					"--max-active-requests",
+					"Max count of requests handled by the manager at once, "
+					"new requests are rejected with 503 when it is reached, "
+					"0 means no limit, "
+					"env: SHRIMP_MAX_ACTIVE_REQUESTS (default: {})" )
 			| make_opt(
 					ip_version, "ip-version",
 					"-P", "--ip-version",
@@ -190,6 +365,86 @@ struct app_args_t
 					result.m_app_params.m_storage.m_root_dir, "images-path",
 					"-i", "--images",
 					"Path for searching images (default: {})" )
+			| make_long_opt(
+					result.m_app_params.m_storage.m_max_open_files, "count",
+					"--max-open-files",
+					"Max count of source images kept opened (default: {})" )
+			| make_long_opt(
+					result.m_app_params.m_transform_manager.m_max_inflight_prefetches,
+					"count",
+					"--max-prefetches",
+					"Max count of source images read in advance in parallel, "
+					"0 turns reading in advance off (default: {})" )
+			| make_long_opt(
+					cache_lifetime, "seconds",
+					"--cache-lifetime",
+					"Max time of storing a transformed image in the cache "
+					"(default: {})" )
+			| make_long_opt(
+					negative_cache_ttl, "seconds",
+					"--negative-cache-ttl",
+					"Time for that failed transformations are remembered "
+					"(default: {})" )
+			| make_long_opt(
+					result.m_app_params.m_transform_manager.m_max_negative_cache_entries,
+					"count",
+					"--negative-cache-size",
+					"Max count of remembered failed transformations, "
+					"0 turns remembering off (default: {})" )
+			| Opt( make_preset_handler( result.m_app_params.m_presets.m_presets ),
+					"name=mode:value[,format=ext][,quality=N][,pinned]"
+					"[,max-age=N][,s-maxage=N][,stale-while-revalidate=N]" )
+					[ "--preset" ]
+					( "Define a named preset (can be used several times), "
+					  "mode is one of width, height or max, "
+					  "for example: thumb=width:128,format=webp,quality=75,pinned" )
+			| Opt( result.m_app_params.m_presets.m_presets_only )
+					[ "--presets-only" ]
+					( "Reject requests with explicit sizes, only presets "
+					  "can be used" )
+			| make_long_opt(
+					result.m_app_params.m_transform.m_size_step_percent,
+					"percents",
+					"--size-step-percent",
+					"Round requested sizes up to the ladder of sizes with "
+					"this step, 0 turns rounding off (default: {})" )
+			| Opt( result.m_app_params.m_transform.m_allow_auto )
+					[ "--allow-auto" ]
+					( "Allow target-format=auto (the format is selected by "
+					  "Accept header) and width=auto (the width is taken from "
+					  "client hints)" )
+			| Opt( result.m_app_params.m_transform.m_no_upscale )
+					[ "--no-upscale" ]
+					( "Don't enlarge images, serve them in the original size "
+					  "if the requested size is bigger" )
+			| make_long_opt(
+					pinned_cache_size_mib, "MiB",
+					"--pinned-cache-size",
+					"Max size of cache for images of pinned presets "
+					"(default: {})" )
+			| Opt( make_cache_control_handler(
+						result.m_app_params.m_caching.m_originals ),
+					"max-age=N[,s-maxage=N][,stale-while-revalidate=N]" )
+					[ "--originals-cache-control" ]
+					( "Cache-Control policy for original images "
+					  "(default: no Cache-Control)" )
+			| Opt( make_cache_control_handler(
+						result.m_app_params.m_caching.m_transformed ),
+					"max-age=N[,s-maxage=N][,stale-while-revalidate=N]" )
+					[ "--transformed-cache-control" ]
+					( "Cache-Control policy for transformed images, "
+					  "presets can override it (default: no Cache-Control)" )
+			| make_long_opt(
+					result.m_app_params.m_caching.m_version_param, "name",
+					"--version-param",
+					"URL parameter with a version of an image, responses for "
+					"such URLs are immutable, empty value turns it off "
+					"(default: {})" )
+			| Opt( result.m_app_params.m_storage.m_watch_sources )
+					[ "--watch-sources" ]
+					( "Watch images directory, reject requests for missing "
+					  "images without processing and remove images made from "
+					  "changed sources from the cache" )
 			| Opt( sobj_tracing )
 					[ "--sobj-tracing" ]
 					( "Turn SObjectizer's message delivery tracing on" )
@@ -227,6 +482,25 @@ struct app_args_t
 					static_cast<shrimp::http_server_params_t::ip_version_t>(
 							ip_version );
 
+		if( 0u == http_server.m_buffer_size ||
+				0u == http_server.m_max_pipelined_requests ||
+				0u == http_server.m_concurrent_accepts )
+			throw shrimp::exception_t{
+					"Read buffer size, count of pipelined requests and "
+					"count of concurrent accepts can't be zero" };
+
+		http_server.m_read_timeout = std::chrono::seconds{ read_timeout };
+		http_server.m_handle_request_timeout =
+				std::chrono::seconds{ handle_request_timeout };
+		http_server.m_write_timeout = std::chrono::seconds{ write_timeout };
+
+		result.m_app_params.m_transform_manager.m_max_cache_lifetime =
+				std::chrono::seconds{ cache_lifetime };
+		result.m_app_params.m_transform_manager.m_negative_cache_ttl =
+				std::chrono::seconds{ negative_cache_ttl };
+		result.m_app_params.m_transform_manager.m_max_pinned_cache_memory_size =
+				pinned_cache_size_mib * 1024u * 1024u;
+
 		if( sobj_tracing )
 			result.m_sobj_tracing = sobj_tracing_t::on;
 
@@ -339,6 +613,8 @@ so_5::mbox_t
 create_agents(
 	spdlog::sink_ptr logger_sink,
 	const shrimp::app_params_t & app_params,
+	const shrimp::source_files_shared_ptr_t & source_files,
+	const std::shared_ptr<shrimp::source_index_t> & source_index,
 	so_5::environment_t & env,
 	unsigned int worker_threads_count )
 {
@@ -358,9 +634,31 @@ create_agents(
 
 			auto manager = coop.make_agent_with_binder< a_transform_manager_t >(
 					create_one_thread_disp( "manager" )->binder(),
-					make_logger( "manager", logger_sink ) );
+					make_logger( "manager", logger_sink ),
+					app_params.m_transform_manager,
+					app_params.m_transform,
+					source_files );
 			manager_mbox = manager->so_direct_mbox();
 
+			// Source images are read in advance on a separate thread pool.
+			// Size of that pool limits the count of parallel reads.
+			// Headers of source images are read on the same pool, so
+			// the pool is created even if images aren't read in advance.
+			const auto max_prefetches =
+					app_params.m_transform_manager.m_max_inflight_prefetches;
+			auto prefetcher = coop.make_agent_with_binder< a_source_prefetcher_t >(
+					so_5::disp::adv_thread_pool::create_private_disp(
+							env,
+							std::max( max_prefetches, std::size_t{ 1u } ),
+							"prefetcher" )->binder(
+									so_5::disp::adv_thread_pool::bind_params_t{} ),
+					make_logger( "prefetcher", logger_sink ),
+					source_files );
+
+			manager->set_source_reader( prefetcher->so_direct_mbox() );
+			if( 0u != max_prefetches )
+				manager->set_prefetcher( prefetcher->so_direct_mbox() );
+
 			// Every worker will work on its own private dispatcher.
 			for( decltype(worker_threads_count) worker{};
 					worker < worker_threads_count;
@@ -370,15 +668,114 @@ create_agents(
 				auto transformer = coop.make_agent_with_binder< a_transformer_t >(
 						create_one_thread_disp( worker_name )->binder(),
 						make_logger( worker_name, logger_sink ),
-						app_params.m_storage );
+						source_files,
+						!app_params.m_transform.m_no_upscale );
 
 				manager->add_worker( transformer->so_direct_mbox() );
 			}
+
+			if( source_index )
+				coop.make_agent_with_binder< a_source_watcher_t >(
+						create_one_thread_disp( "watcher" )->binder(),
+						make_logger( "watcher", logger_sink ),
+						app_params.m_storage,
+						source_index,
+						source_files,
+						manager_mbox );
 		} );
 
 	return manager_mbox;
 }
 
+//! Pin the current thread to a CPU core.
+void
+pin_current_thread_to_core(
+	spdlog::logger & logger,
+	unsigned int core )
+{
+	cpu_set_t cpu_set;
+	CPU_ZERO( &cpu_set );
+	CPU_SET( core, &cpu_set );
+
+	if( const auto rc = pthread_setaffinity_np(
+			pthread_self(), sizeof( cpu_set ), &cpu_set ); 0 != rc )
+		logger.warn( "unable to pin server thread to core {}, error: {}",
+				core, rc );
+}
+
+//! Type of container for contexts of independent servers.
+/*!
+ * Every server has its own context.
+ */
+using io_contexts_t = std::vector< std::unique_ptr< asio::io_context > >;
+
+//! Run independent servers which share the same port.
+/*!
+ * Returns when all servers are stopped.
+ */
+void
+run_reuseport_http_servers(
+	io_contexts_t & io_contexts,
+	const shrimp::app_params_t & params,
+	spdlog::sink_ptr logger_sink,
+	std::shared_ptr<spdlog::logger> restinio_logger,
+	const shrimp::source_files_shared_ptr_t & source_files,
+	const std::shared_ptr<shrimp::source_index_t> & source_index,
+	const std::shared_ptr<shrimp::active_requests_limiter_t> & limiter,
+	const so_5::mbox_t & manager_mbox )
+{
+	const auto logger = make_logger( "run_app", logger_sink );
+	const unsigned int cores = std::thread::hardware_concurrency();
+
+	std::mutex failure_lock;
+	std::exception_ptr failure;
+
+	// These threads only wait for the stop of servers. Every server runs
+	// on its own thread created by restinio::run.
+	std::vector< std::thread > servers;
+	servers.reserve( io_contexts.size() );
+	for( unsigned int i = 0u; i != io_contexts.size(); ++i )
+		servers.emplace_back( [&, i] {
+			auto & io_context = *io_contexts[ i ];
+			try
+			{
+				// The first handler is called on the thread of the server.
+				if( params.m_http_server.m_pin_server_threads && 0u != cores )
+					asio::post( io_context, [&logger, i, cores] {
+							pin_current_thread_to_core( *logger, i % cores );
+						} );
+
+				restinio::run(
+						io_context,
+						shrimp::make_reuseport_http_server_settings(
+								io_context,
+								params,
+								restinio_logger,
+								source_files,
+								source_index,
+								limiter,
+								manager_mbox ) );
+			}
+			catch( const std::exception & x )
+			{
+				logger->critical( "server #{} failed: {}", i, x.what() );
+
+				std::lock_guard< std::mutex > lock{ failure_lock };
+				if( !failure )
+					failure = std::current_exception();
+
+				// Other servers are stopped the same way as by Ctrl+C.
+				std::raise( SIGINT );
+			}
+		} );
+
+	for( auto & t : servers )
+		t.join();
+
+	if( failure )
+		std::rethrow_exception( failure );
+}
+
 void
 run_app(
 	const shrimp::app_params_t & params,
@@ -390,17 +787,40 @@ run_app(
 {
 	auto logger_sink = make_logger_sink();
 	logger_sink->set_level( log_level );
-	
+
+	// Every server with SO_REUSEPORT has exactly one IO thread.
+	const auto reuseport_servers = params.m_http_server.m_reuseport_servers;
 	const auto threads = calculate_thread_count(
-			default_io_threads,
+			0u != reuseport_servers ?
+					std::optional<thread_count_t>{ reuseport_servers } :
+					default_io_threads,
 			default_worker_threads );
 	make_logger( "run_app", logger_sink )->info(
 			"shrimp threads count: io_threads={}, worker_threads={}",
 			threads.m_io_threads.value(),
 			threads.m_worker_threads.value() );
 
-	// ASIO io_context must outlive sobjectizer.
+	// Access to source images is shared between workers and HTTP-server.
+	const auto source_files = std::make_shared< shrimp::source_files_t >(
+			params.m_storage );
+
+	// Index of source images is maintained only if images directory
+	// is watched.
+	const auto source_index = params.m_storage.m_watch_sources ?
+			std::make_shared< shrimp::source_index_t >() : nullptr;
+
+	// The limit of active requests is common for all servers.
+	const auto limiter = 0u != params.m_http_server.m_max_active_requests ?
+			std::make_shared< shrimp::active_requests_limiter_t >(
+					params.m_http_server.m_max_active_requests ) :
+			nullptr;
+
+	// ASIO io_contexts must outlive sobjectizer because responses
+	// are made on them by the manager.
 	asio::io_context asio_io_ctx;
+	io_contexts_t reuseport_io_ctxs;
+	for( unsigned int i = 0u; i != reuseport_servers; ++i )
+		reuseport_io_ctxs.push_back( std::make_unique< asio::io_context >() );
 
 	// Launch SObjectizer and wait while balancer will be started.
 	std::promise< so_5::mbox_t > manager_mbox_promise;
@@ -410,6 +830,8 @@ run_app(
 					create_agents(
 							logger_sink,
 							params,
+							source_files,
+							source_index,
 							env,
 							threads.m_worker_threads.value() ) );
 		},
@@ -428,13 +850,29 @@ run_app(
 			restinio_tracing_t::off == restinio_tracing ?
 					spdlog::level::off : log_level );
 	// If SObjectizer is not started yet we will wait on the future::get() call.
-	restinio::run(
-			asio_io_ctx,
-			shrimp::make_http_server_settings(
-					threads.m_io_threads.value(),
-					params,
-					std::move(restinio_logger),
-					manager_mbox_promise.get_future().get() ) );
+	auto manager_mbox = manager_mbox_promise.get_future().get();
+	if( 0u != reuseport_servers )
+		run_reuseport_http_servers(
+				reuseport_io_ctxs,
+				params,
+				logger_sink,
+				std::move(restinio_logger),
+				source_files,
+				source_index,
+				limiter,
+				manager_mbox );
+	else
+		restinio::run(
+				asio_io_ctx,
+				shrimp::make_http_server_settings(
+						threads.m_io_threads.value(),
+						asio_io_ctx,
+						params,
+						std::move(restinio_logger),
+						source_files,
+						source_index,
+						limiter,
+						std::move(manager_mbox) ) );
 }
 
 //
@@ -9,6 +9,10 @@
 
 #pragma once
 
+#include <shrimp/presets.hpp>
+
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -21,8 +25,139 @@ namespace shrimp {
 //! Paramaters of image storage.
 struct storage_params_t
 {
+	static constexpr std::size_t default_max_open_files = 1024u;
+
 	//! Root directory for original images.
 	std::string m_root_dir{ "." };
+
+	//! Max count of source files to be kept opened.
+	std::size_t m_max_open_files{ default_max_open_files };
+
+	//! Should root directory be watched for changes?
+	/*!
+	 * If it is watched then the index of existing source images is
+	 * maintained and requests for missing images are rejected
+	 * immediately.
+	 */
+	bool m_watch_sources{ false };
+};
+
+//
+// transform_manager_params_t
+//
+
+//! Parameters for the transformation manager.
+struct transform_manager_params_t
+{
+	static constexpr std::size_t default_max_inflight_prefetches = 8u;
+
+	//! Max count of source images which are being read in advance
+	//! at the same time.
+	/*!
+	 * Value 0 turns prefetching of source images off.
+	 */
+	std::size_t m_max_inflight_prefetches{ default_max_inflight_prefetches };
+
+	static constexpr std::chrono::seconds default_max_cache_lifetime{ 3600 };
+
+	//! Max time of storing a transformed image in the cache.
+	/*!
+	 * Images made from changed sources are removed from the cache
+	 * immediately if the storage is watched. So this time can be big
+	 * in that case.
+	 */
+	std::chrono::seconds m_max_cache_lifetime{ default_max_cache_lifetime };
+
+	static constexpr std::chrono::seconds default_negative_cache_ttl{ 10 };
+	static constexpr std::size_t default_max_negative_cache_entries = 1024u;
+
+	//! Time for that failed transformations are remembered.
+	std::chrono::seconds m_negative_cache_ttl{ default_negative_cache_ttl };
+
+	//! Max count of failed transformations to be remembered.
+	/*!
+	 * Value 0 turns remembering of failed transformations off.
+	 */
+	std::size_t m_max_negative_cache_entries{
+			default_max_negative_cache_entries };
+
+	static constexpr std::uint_fast64_t default_max_pinned_cache_memory_size{
+			32ul * 1024ul * 1024ul };
+
+	//! Max size of cache of images for pinned presets.
+	/*!
+	 * Images for pinned presets are stored in the usual cache if
+	 * this limit is reached.
+	 */
+	std::uint_fast64_t m_max_pinned_cache_memory_size{
+			default_max_pinned_cache_memory_size };
+};
+
+//
+// transform_params_t
+//
+
+//! Parameters for handling of transformation requests.
+struct transform_params_t
+{
+	//! Step of the ladder of sizes in percents.
+	/*!
+	 * Requested sizes are rounded up to the nearest value from
+	 * the ladder. Value 0 turns the rounding off.
+	 */
+	std::uint32_t m_size_step_percent{ 0u };
+
+	//! Should images be kept as is instead of being enlarged?
+	bool m_no_upscale{ false };
+
+	//! Are `target-format=auto` and `width=auto` allowed?
+	/*!
+	 * The format is selected by `Accept` header field and the width
+	 * is taken from client hints.
+	 */
+	bool m_allow_auto{ false };
+};
+
+//
+// presets_params_t
+//
+
+//! Parameters of named presets.
+struct presets_params_t
+{
+	//! Known presets.
+	presets_t m_presets;
+
+	//! Are only presets allowed?
+	/*!
+	 * If true requests with explicit sizes are rejected.
+	 */
+	bool m_presets_only{ false };
+};
+
+//
+// caching_params_t
+//
+
+//! Parameters for caching of responses by clients and CDN.
+struct caching_params_t
+{
+	//! Policy for original images.
+	cache_control_policy_t m_originals;
+
+	//! Policy for transformed images.
+	/*!
+	 * Presets can have their own policies.
+	 */
+	cache_control_policy_t m_transformed;
+
+	//! Name of URL parameter with a version of an image.
+	/*!
+	 * If a request has this parameter then the response is immutable
+	 * and is cached for a long time. The value of the parameter
+	 * is ignored. Empty name turns this feature off.
+	 */
+	std::string m_version_param{ "v" };
 };
 
 //
@@ -42,6 +177,60 @@ struct http_server_params_t
 	std::uint16_t m_port{ default_port };
 	ip_version_t m_ip_version{ default_ip_version };
 	std::string m_address{ default_address };
+
+	//! Count of independent servers listening the same port.
+	/*!
+	 * Every server has its own thread and its own io_context. Sockets
+	 * of all servers are bound with SO_REUSEPORT, so the kernel spreads
+	 * connections between them. Value 0 turns this mode off and one
+	 * server on a pool of IO threads is used.
+	 */
+	unsigned int m_reuseport_servers{ 0u };
+
+	//! Should threads of servers in SO_REUSEPORT mode be pinned
+	//! to CPU cores?
+	bool m_pin_server_threads{ false };
+
+	static constexpr std::chrono::seconds default_timeout{ 60 };
+
+	//! Max time for reading of the next request from a connection.
+	std::chrono::seconds m_read_timeout{ default_timeout };
+
+	//! Max time for handling of a request.
+	std::chrono::seconds m_handle_request_timeout{ default_timeout };
+
+	//! Max time for writing of a response.
+	/*!
+	 * Big images can be sent to slow clients for a long time.
+	 */
+	std::chrono::seconds m_write_timeout{ default_timeout };
+
+	static constexpr std::size_t default_buffer_size = 4u * 1024u;
+
+	//! Size of the buffer for reading requests.
+	std::size_t m_buffer_size{ default_buffer_size };
+
+	//! Max count of pipelined requests from one connection.
+	std::size_t m_max_pipelined_requests{ 1u };
+
+	//! Count of parallel accept operations.
+	std::size_t m_concurrent_accepts{ 1u };
+
+	//! Should TCP_NODELAY be set for connections?
+	bool m_tcp_nodelay{ false };
+
+	//! Size of SO_SNDBUF for connections.
+	/*!
+	 * Value 0 means the default size of the system.
+	 */
+	std::size_t m_send_buffer_size{ 0u };
+
+	//! Max count of requests which are handled by the manager at once.
+	/*!
+	 * New requests are rejected with 503 when this limit is reached.
+	 * Value 0 means no limit.
+	 */
+	std::size_t m_max_active_requests{ 0u };
 };
 
 //
@@ -54,6 +243,14 @@ struct app_params_t
 	http_server_params_t m_http_server;
 
 	storage_params_t m_storage;
+
+	transform_manager_params_t m_transform_manager;
+
+	transform_params_t m_transform;
+
+	presets_params_t m_presets;
+
+	caching_params_t m_caching;
 };
 
 } /* namespace shrimp */
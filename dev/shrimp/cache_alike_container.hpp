@@ -13,6 +13,7 @@
 #include <list>
 #include <chrono>
 #include <optional>
+#include <vector>
 
 namespace shrimp {
 
@@ -29,6 +30,9 @@ namespace shrimp {
  *
  * Timestamp for a value can be updated manually by update_access_time()
  * method.
+ *
+ * Keys are compared by transparent comparator. So a range of keys can be
+ * selected by a value of another type (a prefix of keys, for example).
  */
 template<typename Key, typename Value>
 class cache_alike_container_t
@@ -38,7 +42,7 @@ class cache_alike_container_t
 
 	struct wrapped_value_t;
 
-	using map_t = std::map<Key, wrapped_value_t>;
+	using map_t = std::map<Key, wrapped_value_t, std::less<>>;
 
 	struct access_info_t
 	{
@@ -146,6 +150,27 @@ public :
 			return std::nullopt;
 	}
 
+	// Select items starting from the first one which key is not less
+	// than \a from. Items are selected in the order of keys while
+	// \a in_range returns true for the key of an item.
+	//
+	// Bound can be of any type comparable with Key.
+	//
+	// Note: this method is not const because the obtained tokens can be
+	// used for container modification later.
+	template<typename Bound, typename Predicate>
+	[[nodiscard]] std::vector< access_token_t >
+	select_from( const Bound & from, Predicate && in_range )
+	{
+		std::vector< access_token_t > result;
+		for( auto it = m_items.lower_bound( from );
+				it != m_items.end() && in_range( it->first );
+				++it )
+			result.push_back( access_token_t{ it } );
+
+		return result;
+	}
+
 	void
 	erase( access_token_t atoken ) noexcept
 	{
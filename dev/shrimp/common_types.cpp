@@ -0,0 +1,208 @@
+/*
+	Shrimp
+*/
+
+#include <shrimp/common_types.hpp>
+#include <shrimp/magick_utils.hpp>
+
+#include <cctype>
+
+#define XXH_INLINE_ALL
+#include <xxhash/xxhash.h>
+
+namespace shrimp
+{
+
+namespace /* anonymous */
+{
+
+//! Min capacity of a buffer for encoded image.
+constexpr std::size_t min_encoded_buffer_capacity = 16u * 1024u;
+
+//! Estimate the size of encoded image.
+/*!
+ * Values are rough average ratios of encoded size to count of pixels
+ * for images usually served by Shrimp. It is not a problem if
+ * the estimation is wrong: the buffer will be grown or shrunk.
+ */
+[[nodiscard]] std::size_t
+estimate_encoded_size( const Magick::Image & image )
+{
+	const std::size_t pixels = image.columns() * image.rows();
+	const auto magick = image.magick();
+
+	std::size_t estimation = pixels;
+	if( "JPG" == magick || "JPEG" == magick )
+		estimation = pixels / 4u;
+	else if( "WEBP" == magick )
+		estimation = pixels / 6u;
+	else if( "HEIC" == magick )
+		estimation = pixels / 8u;
+	else if( "PNG" == magick )
+		estimation = pixels * 2u;
+	else if( "GIF" == magick )
+		estimation = pixels / 2u;
+
+	return std::max( estimation, min_encoded_buffer_capacity );
+}
+
+//
+// Callbacks for MagickCore's custom stream.
+//
+
+ssize_t
+custom_stream_writer(
+	unsigned char * data,
+	const size_t length,
+	void * user_data )
+{
+	auto & buffer = *reinterpret_cast< encoded_buffer_t * >( user_data );
+	try
+	{
+		buffer.write( data, length );
+		return static_cast< ssize_t >( length );
+	}
+	catch( ... )
+	{
+		return -1;
+	}
+}
+
+MagickCore::MagickOffsetType
+custom_stream_seeker(
+	const MagickCore::MagickOffsetType offset,
+	const int whence,
+	void * user_data )
+{
+	auto & buffer = *reinterpret_cast< encoded_buffer_t * >( user_data );
+
+	MagickCore::MagickOffsetType base = 0;
+	switch( whence )
+	{
+		case SEEK_SET: base = 0; break;
+		case SEEK_CUR:
+			base = static_cast< MagickCore::MagickOffsetType >(
+					buffer.position() );
+		break;
+		case SEEK_END:
+			base = static_cast< MagickCore::MagickOffsetType >(
+					buffer.size() );
+		break;
+		default: return -1;
+	}
+
+	const auto new_position = base + offset;
+	if( new_position < 0 )
+		return -1;
+
+	buffer.seek( static_cast< std::size_t >( new_position ) );
+	return new_position;
+}
+
+MagickCore::MagickOffsetType
+custom_stream_teller( void * user_data )
+{
+	const auto & buffer = *reinterpret_cast< encoded_buffer_t * >( user_data );
+	return static_cast< MagickCore::MagickOffsetType >( buffer.position() );
+}
+
+} /* anonymous namespace */
+
+[[nodiscard]] std::optional< image_format_t >
+image_format_from_extension( std::string_view ext ) noexcept
+{
+	const auto compare_with = [&](std::string_view what) {
+		using namespace std;
+		const auto pred = [](auto ch1, auto ch2) {
+			return tolower(ch1) == tolower(ch2);
+		};
+		return equal( begin(ext), end(ext), begin(what), end(what), pred );
+	};
+
+	if( compare_with("jpg") || compare_with("jpeg") )
+		return image_format_t::jpeg;
+	else if( compare_with("png") )
+		return image_format_t::png;
+	else if( compare_with("gif") )
+		return image_format_t::gif;
+	else if( compare_with("webp") )
+		return image_format_t::webp;
+	else if( compare_with("heic") )
+		return image_format_t::heic;
+	else
+		return {};
+}
+
+[[nodiscard]] std::string_view
+image_format_to_extension( image_format_t format ) noexcept
+{
+	switch( format )
+	{
+		case image_format_t::gif: return "gif";
+		case image_format_t::jpeg: return "jpg";
+		case image_format_t::png: return "png";
+		case image_format_t::webp: return "webp";
+		case image_format_t::heic: return "heic";
+	}
+
+	return {};
+}
+
+[[nodiscard]] std::optional< image_format_t >
+image_format_from_magick( std::string_view magick ) noexcept
+{
+	if( "JPEG" == magick || "JPG" == magick )
+		return image_format_t::jpeg;
+	else if( "GIF" == magick )
+		return image_format_t::gif;
+	else if( "PNG" == magick )
+		return image_format_t::png;
+	else if( "WEBP" == magick )
+		return image_format_t::webp;
+	else if( "HEIC" == magick )
+		return image_format_t::heic;
+	else
+		return {};
+}
+
+[[nodiscard]] std::uint64_t
+hash_content( const void * data, std::size_t size ) noexcept
+{
+	return XXH3_64bits( data, size );
+}
+
+[[nodiscard]] datasizable_blob_shared_ptr_t
+make_blob( Magick::Image & image )
+{
+	encoded_buffer_t buffer{ estimate_encoded_size( image ) };
+
+	auto exception = magick::make_exception_info();
+
+	magick::custom_stream_unique_ptr_t stream{
+			MagickCore::AcquireCustomStreamInfo( exception.get() ) };
+	MagickCore::SetCustomStreamData( stream.get(), &buffer );
+	MagickCore::SetCustomStreamWriter( stream.get(), custom_stream_writer );
+	MagickCore::SetCustomStreamSeeker( stream.get(), custom_stream_seeker );
+	MagickCore::SetCustomStreamTeller( stream.get(), custom_stream_teller );
+
+	// A copy of image info is necessary because we don't want
+	// to modify options of the image itself.
+	magick::image_info_unique_ptr_t image_info{
+			MagickCore::CloneImageInfo( image.constImageInfo() ) };
+	MagickCore::SetImageInfoCustomStream( image_info.get(), stream.get() );
+
+	MagickCore::ImageToCustomStream(
+			image_info.get(),
+			image.image(),
+			exception.get() );
+	Magick::throwException( exception.get(), image.quiet() );
+
+	if( !buffer.size() )
+		throw exception_t{ "image encoder produced no data" };
+
+	buffer.shrink_to_fit();
+
+	return std::make_shared< datasizable_blob_t >( std::move(buffer) );
+}
+
+} /* namespace shrimp */
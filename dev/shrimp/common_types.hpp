@@ -8,13 +8,19 @@
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iosfwd>
 #include <memory>
 #include <optional>
 #include <stdexcept>
+#include <string>
 #include <string_view>
+#include <utility>
 
 #include <so_5/all.hpp>
 
@@ -22,6 +28,8 @@
 
 #include <Magick++.h>
 
+#include <shrimp/http_helpers.hpp>
+
 namespace shrimp
 {
 
@@ -39,6 +47,27 @@ enum class image_format_t
 	heic
 };
 
+//! Get image_format_t from file extension.
+/*!
+ * \return empty value if format can't be detected.
+ */
+[[nodiscard]] std::optional< image_format_t >
+image_format_from_extension( std::string_view ext ) noexcept;
+
+//! Get file extension for image_format_t.
+/*!
+ * The result can be used as a value for `target-format` parameter.
+ */
+[[nodiscard]] std::string_view
+image_format_to_extension( image_format_t format ) noexcept;
+
+//! Get image_format_t from the name of ImageMagick's coder.
+/*!
+ * \return empty value if format isn't supported.
+ */
+[[nodiscard]] std::optional< image_format_t >
+image_format_from_magick( std::string_view magick ) noexcept;
+
 //
 // exception_t
 //
@@ -67,42 +96,215 @@ class exception_t
 		{}
 };
 
+//
+// encoded_buffer_t
+//
+
+//! A Shrimp-owned buffer for an encoded image.
+/*!
+ * Memory is allocated by malloc/realloc. It allows to grow the buffer
+ * in-place (if possible) while an encoder writes to it and to shrink
+ * the buffer to the actual data size when encoding is finished.
+ *
+ * Encoders can seek inside the buffer, so there is a current write
+ * position which can be less than the size of the data.
+ *
+ * \note This is Moveable type, not Copyable.
+ */
+class encoded_buffer_t
+{
+public:
+	encoded_buffer_t() = default;
+
+	explicit encoded_buffer_t( std::size_t initial_capacity )
+	{
+		reserve( initial_capacity );
+	}
+
+	encoded_buffer_t( const encoded_buffer_t & ) = delete;
+	encoded_buffer_t & operator=( const encoded_buffer_t & ) = delete;
+
+	encoded_buffer_t( encoded_buffer_t && o ) noexcept
+		:	m_data{ std::exchange( o.m_data, nullptr ) }
+		,	m_size{ std::exchange( o.m_size, 0u ) }
+		,	m_capacity{ std::exchange( o.m_capacity, 0u ) }
+		,	m_position{ std::exchange( o.m_position, 0u ) }
+	{}
+
+	encoded_buffer_t &
+	operator=( encoded_buffer_t && o ) noexcept
+	{
+		encoded_buffer_t tmp{ std::move(o) };
+		swap( tmp );
+		return *this;
+	}
+
+	~encoded_buffer_t()
+	{
+		std::free( m_data );
+	}
+
+	void
+	swap( encoded_buffer_t & o ) noexcept
+	{
+		std::swap( m_data, o.m_data );
+		std::swap( m_size, o.m_size );
+		std::swap( m_capacity, o.m_capacity );
+		std::swap( m_position, o.m_position );
+	}
+
+	[[nodiscard]] const void *
+	data() const noexcept { return m_data; }
+
+	[[nodiscard]] std::size_t
+	size() const noexcept { return m_size; }
+
+	[[nodiscard]] std::size_t
+	capacity() const noexcept { return m_capacity; }
+
+	[[nodiscard]] std::size_t
+	position() const noexcept { return m_position; }
+
+	//! Change current write position.
+	/*!
+	 * Position can be set beyond the end of the data. The gap will
+	 * be filled with zeros on the next write.
+	 */
+	void
+	seek( std::size_t position ) noexcept { m_position = position; }
+
+	//! Write data at the current position.
+	void
+	write( const void * what, std::size_t length )
+	{
+		const auto new_position = m_position + length;
+		if( new_position > m_capacity )
+			reserve( std::max( new_position, m_capacity + m_capacity / 2u ) );
+
+		if( m_position > m_size )
+			std::memset( m_data + m_size, 0, m_position - m_size );
+
+		std::memcpy( m_data + m_position, what, length );
+		m_position = new_position;
+		m_size = std::max( m_size, new_position );
+	}
+
+	void
+	reserve( std::size_t capacity )
+	{
+		if( capacity > m_capacity )
+			reallocate( capacity );
+	}
+
+	//! Release unused memory at the end of the buffer.
+	void
+	shrink_to_fit()
+	{
+		if( m_size && m_size < m_capacity )
+			reallocate( m_size );
+	}
+
+private:
+	void
+	reallocate( std::size_t capacity )
+	{
+		auto * p = static_cast< char * >( std::realloc( m_data, capacity ) );
+		if( !p )
+			throw std::bad_alloc{};
+
+		m_data = p;
+		m_capacity = capacity;
+	}
+
+	char * m_data{ nullptr };
+	std::size_t m_size{ 0u };
+	std::size_t m_capacity{ 0u };
+	std::size_t m_position{ 0u };
+};
+
+//
+// hash_content()
+//
+
+//! Calculate a hash of a block of data.
+/*!
+ * XXH3 is used, it is fast enough to be calculated for every
+ * transformed image.
+ */
+[[nodiscard]] std::uint64_t
+hash_content( const void * data, std::size_t size ) noexcept;
+
 //
 // datasizable_blob_t
 //
 
 //! Blob for transformed image.
-struct datasizable_blob_t : public std::enable_shared_from_this< datasizable_blob_t >
+/*!
+ * \note Object is intended to be created by std::make_shared, so
+ * the metadata and the reference counter live in the same allocation.
+ * Encoded data itself is held in a single buffer owned by this object.
+ *
+ * The hash of the content is calculated at the construction time, so
+ * it is done by a worker thread. Values of header fields which
+ * don't change between responses are formatted at the same time and
+ * are reused for every cache hit.
+ */
+struct datasizable_blob_t
 {
+	datasizable_blob_t( encoded_buffer_t buffer )
+		:	m_buffer{ std::move(buffer) }
+		,	m_hash{ hash_content( m_buffer.data(), m_buffer.size() ) }
+		,	m_etag{ fmt::format( "\"{:016x}\"", m_hash ) }
+	{}
+
 	const void *
 	data() const noexcept
 	{
-		return m_blob.data();
+		return m_buffer.data();
 	}
 
 	std::size_t
 	size() const noexcept
 	{
-		return m_blob.length();
+		return m_buffer.size();
 	}
 
-	Magick::Blob m_blob;
+	//! Does the blob have the same content as the another one?
+	[[nodiscard]] bool
+	same_content( const datasizable_blob_t & o ) const noexcept
+	{
+		return m_hash == o.m_hash && size() == o.size() &&
+				0 == std::memcmp( data(), o.data(), size() );
+	}
 
-	//! Value for `Last-Modified` http header field.
+	//! Encoded image.
+	const encoded_buffer_t m_buffer;
+
+	//! Hash of the encoded image.
+	const std::uint64_t m_hash;
+
+	//! Value for `ETag` http header field.
+	const std::string m_etag;
+
+	//! Modification time of the blob.
 	const std::chrono::system_clock::time_point m_last_modified_at{
 			std::chrono::system_clock::now() };
+
+	//! Value for `Last-Modified` http header field.
+	const std::string m_last_modified_value{
+			format_http_date( m_last_modified_at ) };
 };
 
 using datasizable_blob_shared_ptr_t = std::shared_ptr< datasizable_blob_t >;
 
-inline datasizable_blob_shared_ptr_t
-make_blob( Magick::Image & image )
-{
-	auto blob = std::make_shared< datasizable_blob_t >();
-	image.write( &blob->m_blob );
-
-	return blob;
-}
+//! Encode an image into a new blob.
+/*!
+ * Encoder writes directly into a buffer owned by the blob. The initial
+ * size of that buffer is estimated by the image dimensions and
+ * the target format.
+ */
+[[nodiscard]] datasizable_blob_shared_ptr_t
+make_blob( Magick::Image & image );
 
 //
 // sobj_shptr_t
@@ -0,0 +1,489 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Helpers for handling of HTTP header fields.
+ */
+
+#include <shrimp/http_helpers.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <charconv>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+#include <limits>
+
+using namespace std::literals;
+
+namespace shrimp {
+
+namespace /* anonymous */
+{
+
+//! Parse a number of exactly \a digits digits.
+[[nodiscard]] std::optional< int >
+parse_fixed_number( std::string_view & from, std::size_t digits ) noexcept
+{
+	if( from.size() < digits )
+		return std::nullopt;
+
+	int result = 0;
+	for( std::size_t i = 0u; i != digits; ++i )
+	{
+		if( !std::isdigit( static_cast< unsigned char >( from[ i ] ) ) )
+			return std::nullopt;
+		result = result * 10 + ( from[ i ] - '0' );
+	}
+
+	from.remove_prefix( digits );
+	return result;
+}
+
+//! Remove the expected literal from the beginning of a value.
+[[nodiscard]] bool
+skip_literal( std::string_view & from, std::string_view literal ) noexcept
+{
+	if( from.substr( 0, literal.size() ) != literal )
+		return false;
+
+	from.remove_prefix( literal.size() );
+	return true;
+}
+
+[[nodiscard]] std::string_view
+trim( std::string_view what ) noexcept
+{
+	const auto first = what.find_first_not_of( " \t" );
+	if( std::string_view::npos == first )
+		return {};
+
+	return what.substr( first, what.find_last_not_of( " \t" ) + 1u - first );
+}
+
+//! Parse a non-negative decimal number which takes the whole value.
+[[nodiscard]] std::optional< std::uint64_t >
+parse_position( std::string_view what ) noexcept
+{
+	std::uint64_t result{};
+	const auto [ptr, ec] = std::from_chars(
+			what.data(), what.data() + what.size(), result );
+	if( what.empty() || std::errc{} != ec || what.data() + what.size() != ptr )
+		return std::nullopt;
+
+	return result;
+}
+
+//! Parse a positive decimal number with an optional fraction.
+[[nodiscard]] std::optional< double >
+parse_positive_decimal( std::string_view what ) noexcept
+{
+	what = trim( what );
+
+	double result = 0.0;
+	double scale = 0.0;
+	bool has_digits = false;
+	for( const char ch : what )
+	{
+		if( '.' == ch && 0.0 == scale )
+			scale = 1.0;
+		else if( std::isdigit( static_cast< unsigned char >( ch ) ) )
+		{
+			has_digits = true;
+			if( 0.0 == scale )
+				result = result * 10.0 + ( ch - '0' );
+			else
+			{
+				scale /= 10.0;
+				result += ( ch - '0' ) * scale;
+			}
+		}
+		else
+			return std::nullopt;
+	}
+
+	if( !has_digits || !( 0.0 < result ) )
+		return std::nullopt;
+
+	return result;
+}
+
+//! Remove the weakness indicator from an ETag.
+[[nodiscard]] std::string_view
+opaque_tag( std::string_view etag ) noexcept
+{
+	if( "W/"sv == etag.substr( 0, 2 ) )
+		etag.remove_prefix( 2 );
+	return etag;
+}
+
+} /* anonymous namespace */
+
+//
+// parse_http_date()
+//
+
+[[nodiscard]] std::optional< std::chrono::system_clock::time_point >
+parse_http_date( std::string_view value ) noexcept
+{
+	static constexpr std::array< std::string_view, 12 > months{
+			"Jan"sv, "Feb"sv, "Mar"sv, "Apr"sv, "May"sv, "Jun"sv,
+			"Jul"sv, "Aug"sv, "Sep"sv, "Oct"sv, "Nov"sv, "Dec"sv };
+
+	// The day name is ignored.
+	const auto comma = value.find( ", " );
+	if( std::string_view::npos == comma )
+		return std::nullopt;
+	value.remove_prefix( comma + 2u );
+
+	std::tm tm{};
+
+	const auto day = parse_fixed_number( value, 2u );
+	if( !day || !skip_literal( value, " " ) )
+		return std::nullopt;
+	tm.tm_mday = *day;
+
+	const auto month = value.substr( 0, 3 );
+	std::size_t month_index = 0u;
+	while( month_index != months.size() && months[ month_index ] != month )
+		++month_index;
+	if( months.size() == month_index )
+		return std::nullopt;
+	tm.tm_mon = static_cast< int >( month_index );
+	value.remove_prefix( month.size() );
+
+	if( !skip_literal( value, " " ) )
+		return std::nullopt;
+	const auto year = parse_fixed_number( value, 4u );
+	if( !year || !skip_literal( value, " " ) )
+		return std::nullopt;
+	tm.tm_year = *year - 1900;
+
+	const auto hour = parse_fixed_number( value, 2u );
+	if( !hour || !skip_literal( value, ":" ) )
+		return std::nullopt;
+	const auto minute = parse_fixed_number( value, 2u );
+	if( !minute || !skip_literal( value, ":" ) )
+		return std::nullopt;
+	const auto second = parse_fixed_number( value, 2u );
+	if( !second || " GMT"sv != value )
+		return std::nullopt;
+	tm.tm_hour = *hour;
+	tm.tm_min = *minute;
+	tm.tm_sec = *second;
+
+	if( 31 < tm.tm_mday || 0 == tm.tm_mday || 23 < tm.tm_hour ||
+			59 < tm.tm_min || 60 < tm.tm_sec )
+		return std::nullopt;
+
+	return std::chrono::system_clock::from_time_t( ::timegm( &tm ) );
+}
+
+//
+// format_http_date()
+//
+
+[[nodiscard]] std::string
+format_http_date( std::chrono::system_clock::time_point value )
+{
+	const auto t = std::chrono::system_clock::to_time_t( value );
+	std::tm tm{};
+	::gmtime_r( &t, &tm );
+
+	std::array< char, 32 > buf;
+	const auto size = std::strftime(
+			buf.data(), buf.size(), "%a, %d %b %Y %H:%M:%S GMT", &tm );
+
+	return std::string{ buf.data(), size };
+}
+
+//
+// current_http_date()
+//
+
+[[nodiscard]] const std::string &
+current_http_date()
+{
+	struct cached_date_t
+	{
+		std::time_t m_second{ -1 };
+		std::string m_value;
+	};
+	thread_local cached_date_t cached;
+
+	const auto now = std::time( nullptr );
+	if( now != cached.m_second )
+	{
+		cached.m_value = format_http_date(
+				std::chrono::system_clock::from_time_t( now ) );
+		cached.m_second = now;
+	}
+
+	return cached.m_value;
+}
+
+//
+// etag_list_matches()
+//
+
+[[nodiscard]] bool
+etag_list_matches( std::string_view list, std::string_view etag ) noexcept
+{
+	if( "*"sv == trim( list ) )
+		return true;
+
+	const auto expected = opaque_tag( etag );
+	while( !list.empty() )
+	{
+		const auto comma = list.find( ',' );
+		const auto item = trim( list.substr( 0, comma ) );
+		if( !item.empty() && opaque_tag( item ) == expected )
+			return true;
+
+		list.remove_prefix(
+				std::string_view::npos == comma ? list.size() : comma + 1u );
+	}
+
+	return false;
+}
+
+//
+// is_not_modified()
+//
+
+[[nodiscard]] bool
+is_not_modified(
+	std::optional< std::string_view > if_none_match,
+	std::optional< std::string_view > if_modified_since,
+	std::string_view etag,
+	std::chrono::system_clock::time_point last_modified ) noexcept
+{
+	if( if_none_match )
+		return etag_list_matches( *if_none_match, etag );
+
+	if( if_modified_since )
+		if( const auto since = parse_http_date( *if_modified_since ) )
+			// Dates in HTTP header fields have precision of one second.
+			return std::chrono::time_point_cast< std::chrono::seconds >(
+					last_modified ) <= *since;
+
+	return false;
+}
+
+//
+// parse_byte_ranges()
+//
+
+[[nodiscard]] std::optional< std::vector< byte_range_t > >
+parse_byte_ranges(
+	std::string_view value,
+	std::uint64_t resource_size,
+	std::size_t max_ranges )
+{
+	value = trim( value );
+	if( !skip_literal( value, "bytes=" ) )
+		return std::nullopt;
+
+	std::vector< byte_range_t > result;
+	std::size_t count = 0u;
+	while( !value.empty() )
+	{
+		const auto comma = value.find( ',' );
+		const auto item = trim( value.substr( 0, comma ) );
+		value.remove_prefix(
+				std::string_view::npos == comma ? value.size() : comma + 1u );
+
+		// Empty elements of the list are allowed.
+		if( item.empty() )
+			continue;
+
+		if( max_ranges < ++count )
+			return std::nullopt;
+
+		const auto dash = item.find( '-' );
+		if( std::string_view::npos == dash )
+			return std::nullopt;
+
+		const auto first = item.substr( 0, dash );
+		const auto last = item.substr( dash + 1u );
+		if( first.empty() )
+		{
+			// A suffix: the last N bytes.
+			const auto suffix = parse_position( last );
+			if( !suffix )
+				return std::nullopt;
+
+			const auto size = std::min( *suffix, resource_size );
+			if( size )
+				result.push_back( byte_range_t{ resource_size - size, size } );
+		}
+		else
+		{
+			const auto first_pos = parse_position( first );
+			if( !first_pos )
+				return std::nullopt;
+
+			auto last_pos = resource_size ? resource_size - 1u : 0u;
+			if( !last.empty() )
+			{
+				const auto v = parse_position( last );
+				if( !v || *v < *first_pos )
+					return std::nullopt;
+				last_pos = std::min( *v, last_pos );
+			}
+
+			if( *first_pos < resource_size )
+				result.push_back(
+						byte_range_t{ *first_pos, last_pos - *first_pos + 1u } );
+		}
+	}
+
+	if( !count )
+		return std::nullopt;
+
+	return result;
+}
+
+//
+// if_range_matches()
+//
+
+[[nodiscard]] bool
+if_range_matches(
+	std::string_view if_range,
+	std::string_view etag,
+	std::chrono::system_clock::time_point last_modified ) noexcept
+{
+	if_range = trim( if_range );
+	if( "\""sv == if_range.substr( 0, 1 ) || "W/"sv == if_range.substr( 0, 2 ) )
+		// Weak ETags never match.
+		return "W/"sv != etag.substr( 0, 2 ) && if_range == etag;
+
+	const auto date = parse_http_date( if_range );
+	return date && std::chrono::time_point_cast< std::chrono::seconds >(
+			last_modified ) == *date;
+}
+
+//
+// accepts_media_type()
+//
+
+[[nodiscard]] bool
+accepts_media_type(
+	std::string_view accept,
+	std::string_view media_type ) noexcept
+{
+	while( !accept.empty() )
+	{
+		const auto comma = accept.find( ',' );
+		auto item = accept.substr( 0, comma );
+		accept.remove_prefix(
+				std::string_view::npos == comma ? accept.size() : comma + 1u );
+
+		// Parameters of a media range are separated by ';'.
+		const auto semicolon = item.find( ';' );
+		if( trim( item.substr( 0, semicolon ) ) != media_type )
+			continue;
+
+		// Only zero quality is important: the type isn't acceptable.
+		auto params = std::string_view::npos == semicolon ?
+				std::string_view{} : item.substr( semicolon + 1u );
+		bool rejected = false;
+		while( !params.empty() )
+		{
+			const auto next = params.find( ';' );
+			const auto param = trim( params.substr( 0, next ) );
+			params.remove_prefix(
+					std::string_view::npos == next ? params.size() : next + 1u );
+
+			if( "q="sv == param.substr( 0, 2 ) )
+				rejected = !parse_positive_decimal( param.substr( 2 ) );
+		}
+
+		return !rejected;
+	}
+
+	return false;
+}
+
+//
+// width_from_client_hints()
+//
+
+[[nodiscard]] std::optional< std::uint32_t >
+width_from_client_hints(
+	std::optional< std::string_view > width,
+	std::optional< std::string_view > dpr,
+	std::optional< std::string_view > viewport_width ) noexcept
+{
+	if( width )
+		if( const auto w = parse_position( trim( *width ) ); w && *w &&
+				*w <= std::numeric_limits< std::uint32_t >::max() )
+			return static_cast< std::uint32_t >( *w );
+
+	if( !viewport_width )
+		return std::nullopt;
+
+	const auto vw = parse_position( trim( *viewport_width ) );
+	if( !vw || !*vw )
+		return std::nullopt;
+
+	double ratio = 1.0;
+	if( dpr )
+		if( const auto v = parse_positive_decimal( *dpr ) )
+			ratio = *v;
+
+	const auto result = std::ceil( static_cast< double >( *vw ) * ratio );
+	if( !( result <= std::numeric_limits< std::uint32_t >::max() ) )
+		return std::nullopt;
+
+	return static_cast< std::uint32_t >( result );
+}
+
+//
+// make_cache_control_value()
+//
+
+[[nodiscard]] std::string
+make_cache_control_value(
+	const cache_control_policy_t & policy,
+	bool immutable )
+{
+	if( immutable )
+		return fmt::format( "public, max-age={}, immutable", immutable_max_age );
+
+	if( policy.empty() )
+		return {};
+
+	std::string result{ "public" };
+	if( policy.m_max_age )
+		result += fmt::format( ", max-age={}", *policy.m_max_age );
+	if( policy.m_s_maxage )
+		result += fmt::format( ", s-maxage={}", *policy.m_s_maxage );
+	if( policy.m_stale_while_revalidate )
+		result += fmt::format( ", stale-while-revalidate={}",
+				*policy.m_stale_while_revalidate );
+
+	return result;
+}
+
+//
+// make_content_range_value()
+//
+
+[[nodiscard]] std::string
+make_content_range_value(
+	const byte_range_t & range,
+	std::uint64_t resource_size )
+{
+	return fmt::format( "bytes {}-{}/{}",
+			range.m_first,
+			range.m_first + range.m_size - 1u,
+			resource_size );
+}
+
+} /* namespace shrimp */
@@ -0,0 +1,249 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Helpers for handling of HTTP header fields.
+ *
+ * These helpers don't depend on RESTinio, they work with values
+ * of header fields only.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace shrimp {
+
+//
+// parse_http_date()
+//
+
+//! Parse a value of HTTP header field of Date type.
+/*!
+ * Only the preferred format from RFC 7231 is supported:
+ * \code
+ * Sun, 06 Nov 1994 08:49:37 GMT
+ * \endcode
+ *
+ * \return empty value if the value can't be parsed.
+ */
+[[nodiscard]] std::optional< std::chrono::system_clock::time_point >
+parse_http_date( std::string_view value ) noexcept;
+
+//
+// format_http_date()
+//
+
+//! Make a value of HTTP header field of Date type.
+/*!
+ * The preferred format from RFC 7231 is used, the same which is
+ * accepted by parse_http_date().
+ */
+[[nodiscard]] std::string
+format_http_date( std::chrono::system_clock::time_point value );
+
+//
+// current_http_date()
+//
+
+//! Get a value for `Date` header field for the current time.
+/*!
+ * The value is formatted only once per second in every thread and
+ * then reused for all responses sent during that second.
+ *
+ * \note The reference is valid until the next call in the same thread.
+ */
+[[nodiscard]] const std::string &
+current_http_date();
+
+//
+// etag_list_matches()
+//
+
+//! Check a value of `If-None-Match` header field against an ETag.
+/*!
+ * Value of the header field is `*` or a comma-separated list of ETags.
+ * Weak comparison is used as RFC 7232 requires for `If-None-Match`.
+ */
+[[nodiscard]] bool
+etag_list_matches( std::string_view list, std::string_view etag ) noexcept;
+
+//
+// is_not_modified()
+//
+
+//! Check that the copy of the client is still current.
+/*!
+ * `If-None-Match` has the priority. `If-Modified-Since` is used only
+ * if there is no `If-None-Match`. Invalid dates are ignored.
+ *
+ * \return true if the response with 304 status code should be sent.
+ */
+[[nodiscard]] bool
+is_not_modified(
+	//! Value of `If-None-Match` header field.
+	std::optional< std::string_view > if_none_match,
+	//! Value of `If-Modified-Since` header field.
+	std::optional< std::string_view > if_modified_since,
+	//! Current ETag of the resource.
+	std::string_view etag,
+	//! Current modification time of the resource.
+	std::chrono::system_clock::time_point last_modified ) noexcept;
+
+//
+// byte_range_t
+//
+
+//! A range of bytes of a resource.
+struct byte_range_t
+{
+	//! Offset of the first byte.
+	std::uint64_t m_first;
+	//! Count of bytes in the range. Always greater than zero.
+	std::uint64_t m_size;
+
+	[[nodiscard]] bool
+	operator==( const byte_range_t & o ) const noexcept
+	{
+		return m_first == o.m_first && m_size == o.m_size;
+	}
+};
+
+//
+// parse_byte_ranges()
+//
+
+//! Parse a value of `Range` header field.
+/*!
+ * Ranges which start after the end of the resource are dropped.
+ * Ranges which end after the end of the resource are truncated.
+ *
+ * \return empty value if `Range` header field should be ignored
+ * (the value is invalid, the unit isn't `bytes` or there are more than
+ * \a max_ranges ranges). Empty vector if the range isn't satisfiable.
+ */
+[[nodiscard]] std::optional< std::vector< byte_range_t > >
+parse_byte_ranges(
+	//! Value of `Range` header field.
+	std::string_view value,
+	//! Size of the resource.
+	std::uint64_t resource_size,
+	//! Max count of ranges in one request.
+	std::size_t max_ranges );
+
+//
+// if_range_matches()
+//
+
+//! Check a value of `If-Range` header field.
+/*!
+ * The value is either an ETag or a date. Strong comparison is used
+ * for ETags. A date must be equal to the modification time of
+ * the resource.
+ *
+ * \return false if the whole resource should be sent instead of ranges.
+ */
+[[nodiscard]] bool
+if_range_matches(
+	std::string_view if_range,
+	std::string_view etag,
+	std::chrono::system_clock::time_point last_modified ) noexcept;
+
+//
+// accepts_media_type()
+//
+
+//! Check that a media type is acceptable for a client.
+/*!
+ * The media type must be listed in `Accept` header field explicitly
+ * with non-zero quality. Wildcards like `image/ *` are ignored because
+ * browsers send them even for formats they don't support.
+ */
+[[nodiscard]] bool
+accepts_media_type(
+	//! Value of `Accept` header field.
+	std::string_view accept,
+	//! Media type to be checked, like `image/webp`.
+	std::string_view media_type ) noexcept;
+
+//
+// width_from_client_hints()
+//
+
+//! Calculate the width of an image in device pixels from client hints.
+/*!
+ * `Width` hint has the priority because it is already in device pixels.
+ * Otherwise `Viewport-Width` is multiplied by `DPR` (1.0 by default).
+ *
+ * \return empty value if there are no valid hints.
+ */
+[[nodiscard]] std::optional< std::uint32_t >
+width_from_client_hints(
+	//! Value of `Width` hint.
+	std::optional< std::string_view > width,
+	//! Value of `DPR` hint.
+	std::optional< std::string_view > dpr,
+	//! Value of `Viewport-Width` hint.
+	std::optional< std::string_view > viewport_width ) noexcept;
+
+//
+// cache_control_policy_t
+//
+
+//! Policy for `Cache-Control` header field of responses.
+/*!
+ * Directives without values aren't sent.
+ */
+struct cache_control_policy_t
+{
+	//! Value for `max-age` directive in seconds.
+	std::optional< std::uint32_t > m_max_age;
+	//! Value for `s-maxage` directive in seconds.
+	std::optional< std::uint32_t > m_s_maxage;
+	//! Value for `stale-while-revalidate` directive in seconds.
+	std::optional< std::uint32_t > m_stale_while_revalidate;
+
+	[[nodiscard]] bool
+	empty() const noexcept
+	{
+		return !m_max_age && !m_s_maxage && !m_stale_while_revalidate;
+	}
+};
+
+//! Max age for responses which are never changed: one year.
+inline constexpr std::uint32_t immutable_max_age = 365u * 24u * 60u * 60u;
+
+//
+// make_cache_control_value()
+//
+
+//! Make a value for `Cache-Control` header field.
+/*!
+ * Responses for URLs with a version of the resource are immutable.
+ * They are cached for immutable_max_age regardless of the policy.
+ *
+ * \return empty string if `Cache-Control` shouldn't be sent.
+ */
+[[nodiscard]] std::string
+make_cache_control_value(
+	const cache_control_policy_t & policy,
+	bool immutable );
+
+//
+// make_content_range_value()
+//
+
+//! Make a value for `Content-Range` header field.
+[[nodiscard]] std::string
+make_content_range_value(
+	const byte_range_t & range,
+	std::uint64_t resource_size );
+
+} /* namespace shrimp */
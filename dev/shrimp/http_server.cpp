@@ -3,11 +3,14 @@
 */
 
 #include <shrimp/http_server.hpp>
+#include <shrimp/http_helpers.hpp>
 #include <shrimp/response_common.hpp>
 #include <shrimp/utils.hpp>
 #include <shrimp/a_transform_manager.hpp>
 
 #include <algorithm>
+#include <charconv>
+#include <iterator>
 #include <optional>
 #include <cctype>
 
@@ -19,35 +22,6 @@ namespace shrimp
 namespace /* anonymous */
 {
 
-//! Get image_format_t from file extension.
-/*!
- * \return empty value if format can't be detected.
- */
-[[nodiscard]] std::optional< image_format_t >
-image_format_from_extension( std::string_view ext ) noexcept
-{
-	const auto compare_with = [&](std::string_view what) {
-		using namespace std;
-		const auto pred = [](auto ch1, auto ch2) {
-			return tolower(ch1) == tolower(ch2);
-		};
-		return equal( begin(ext), end(ext), begin(what), end(what), pred );
-	};
-
-	if( compare_with("jpg") || compare_with("jpeg") )
-		return image_format_t::jpeg;
-	else if( compare_with("png") )
-		return image_format_t::png;
-	else if( compare_with("gif") )
-		return image_format_t::gif;
-	else if( compare_with("webp") )
-		return image_format_t::webp;
-	else if( compare_with("heic") )
-		return image_format_t::heic;
-	else
-		return {};
-}
-
 //! Try detect target image format from request's parameters.
 /*!
  * \return empty value if format can't be detected.
@@ -65,6 +39,80 @@ try_detect_target_image_format(
 		return image_format_from_extension( image_ext );
 }
 
+//! Select target image format for `target-format=auto`.
+/*!
+ * WebP is used if the client supports it. Otherwise the format
+ * from the extension of the image is used.
+ */
+[[nodiscard]] std::optional< image_format_t >
+select_auto_image_format(
+	const restinio::request_t & req,
+	std::string_view image_ext )
+{
+	const auto accept = try_get_header_field( req, restinio::http_field::accept );
+	if( accept && accepts_media_type( *accept, "image/webp" ) )
+		return image_format_t::webp;
+
+	return image_format_from_extension( image_ext );
+}
+
+//! Get a value of a client hint.
+/*!
+ * Hints can be sent with `Sec-CH-` prefix or without it.
+ */
+[[nodiscard]] std::optional< std::string_view >
+try_get_client_hint(
+	const restinio::request_t & req,
+	std::string_view name )
+{
+	const auto prefixed = fmt::format( "Sec-CH-{}", name );
+	if( req.header().has_field( prefixed ) )
+		return std::string_view{ req.header().get_field( prefixed ) };
+
+	if( req.header().has_field( name ) )
+		return std::string_view{ req.header().get_field( name ) };
+
+	return std::nullopt;
+}
+
+//! Get the width for `width=auto` from client hints.
+/*!
+ * \return empty value if the client sent no hints.
+ */
+[[nodiscard]] std::optional< std::uint32_t >
+auto_width( const restinio::request_t & req )
+{
+	const auto width = width_from_client_hints(
+			try_get_client_hint( req, "Width" ),
+			try_get_client_hint( req, "DPR" ),
+			try_get_client_hint( req, "Viewport-Width" ) );
+	if( !width )
+		return std::nullopt;
+
+	// Hints can't make a request invalid.
+	return std::min( *width,
+			transform::resize_params_constraints_t::default_max_side );
+}
+
+//! Get a numeric value of a parameter from the query string.
+/*!
+ * \throw exception_t if the value isn't a valid number.
+ */
+[[nodiscard]] std::optional< std::uint32_t >
+query_number( std::optional< std::string_view > value )
+{
+	if( !value )
+		return std::nullopt;
+
+	std::uint32_t result{};
+	const auto [ptr, ec] = std::from_chars(
+			value->data(), value->data() + value->size(), result );
+	if( std::errc{} != ec || value->data() + value->size() != ptr )
+		throw exception_t{ "invalid number in query string: '{}'", *value };
+
+	return result;
+}
+
 template < typename Handler >
 void
 try_to_handle_request(
@@ -81,6 +129,57 @@ try_to_handle_request(
 	}
 }
 
+//! Resize parameters of a request after the resolution of its preset.
+struct resolved_resize_params_t
+{
+	transform::resize_params_t m_params;
+	//! Quality for the encoder. Value 0 means the default quality.
+	std::uint32_t m_quality{ 0u };
+	//! Should the transformed image be kept in the cache permanently?
+	bool m_pinned{ false };
+};
+
+//! Resolve resize parameters of a request.
+/*!
+ * Parameters of the preset are used if the preset is specified.
+ * An explicit size can't be used together with a preset and isn't
+ * allowed at all if only presets are allowed.
+ *
+ * \throw exception_t if the parameters are invalid.
+ */
+[[nodiscard]] resolved_resize_params_t
+resolve_resize_params(
+	const presets_params_t & presets_params,
+	//! Preset from the request. Can be nullptr.
+	const preset_t * preset,
+	//! Size from the request.
+	const transform::resize_params_t & requested,
+	//! Is the size taken from client hints?
+	bool auto_size )
+{
+	if( auto_size ||
+			transform::resize_params_t::mode_t::keep_original !=
+					requested.mode() )
+	{
+		if( preset )
+			throw exception_t{ "preset can't be used with explicit size" };
+		if( presets_params.m_presets_only )
+			throw exception_t{ "only presets are allowed" };
+	}
+
+	resolved_resize_params_t result{ requested, 0u, false };
+	if( preset )
+	{
+		result.m_params = preset->m_params;
+		result.m_quality = preset->m_quality;
+		result.m_pinned = preset->m_pinned;
+	}
+
+	transform::resize_params_constraints_t{}.check( result.m_params );
+
+	return result;
+}
+
 //
 // handle_resize_op_request()
 //
@@ -88,31 +187,164 @@ try_to_handle_request(
 void
 handle_resize_op_request(
 	const so_5::mbox_t & req_handler_mbox,
+	const app_params_t & app_params,
+	//! Preset from the request. Can be nullptr.
+	const preset_t * preset,
 	image_format_t image_format,
-	const restinio::query_string_params_t & qp,
+	//! Does the URL contain a version of the image?
+	bool versioned,
+	//! Was the target format selected by Accept header field?
+	bool auto_format,
+	const image_query_t & query,
+	//! Limiter of active requests. Can be nullptr.
+	active_requests_limiter_t * limiter,
+	restinio::asio_ns::io_context & io_context,
 	restinio::request_handle_t req )
 {
+	const auto & transform_params = app_params.m_transform;
+
 	try_to_handle_request(
 		[&]{
-			auto op_params = transform::resize_params_t::make(
-				restinio::opt_value< std::uint32_t >( qp, "width" ),
-				restinio::opt_value< std::uint32_t >( qp, "height" ),
-				restinio::opt_value< std::uint32_t >( qp, "max" ) );
+			const bool auto_size = transform_params.m_allow_auto &&
+					"auto"sv == query.m_width;
 
-			transform::resize_params_constraints_t{}.check( op_params );
+			const auto resolved = resolve_resize_params(
+					app_params.m_presets,
+					preset,
+					transform::resize_params_t::make(
+							auto_size ?
+									auto_width( *req ) :
+									query_number( query.m_width ),
+							query_number( query.m_height ),
+							query_number( query.m_max ) ),
+					auto_size );
 
 			std::string image_path{ req->header().path() };
+
+			auto response_headers = make_caching_header_fields(
+					preset && !preset->m_cache_control.empty() ?
+							preset->m_cache_control :
+							app_params.m_caching.m_transformed,
+					versioned );
+
+			// Caches must know that the response depends on
+			// header fields of the request.
+			if( auto_format || auto_size )
+			{
+				std::string vary;
+				if( auto_format )
+					vary = "Accept";
+				if( auto_size )
+				{
+					if( !vary.empty() )
+						vary += ", ";
+					vary.append( http_header::client_hints_list() );
+
+					response_headers.emplace_back(
+							"Accept-CH"sv,
+							http_header::client_hints_list() );
+				}
+
+				response_headers.emplace_back(
+						restinio::http_field::vary, std::move( vary ) );
+			}
+
+			// The manager isn't bothered if it is already overloaded.
+			active_request_guard_t active_request;
+			if( limiter )
+			{
+				auto guard = limiter->try_acquire();
+				if( !guard )
+				{
+					do_503_response( std::move( req ) );
+					return;
+				}
+				active_request = std::move( *guard );
+			}
+
 			so_5::send<
 						so_5::mutable_msg<a_transform_manager_t::resize_request_t>>(
 					req_handler_mbox,
 					std::move(req),
 					std::move(image_path),
 					image_format,
-					op_params );
+					resolved.m_params,
+					resolved.m_quality,
+					resolved.m_pinned,
+					// Sizes from presets are used as is.
+					!preset,
+					std::move(response_headers),
+					std::move(active_request),
+					&io_context );
 		},
 		req );
 }
 
+//
+// handle_info_op_request()
+//
+
+//! Handle a request for information about a source image.
+/*!
+ * Only the header of the image is read, and only if the image
+ * wasn't decoded or read before. Workers aren't used and the header
+ * isn't read on the thread of the server.
+ */
+void
+handle_info_op_request(
+	const so_5::mbox_t & req_handler_mbox,
+	restinio::asio_ns::io_context & io_context,
+	restinio::request_handle_t req )
+{
+	std::string image_path{ req->header().path() };
+
+	so_5::send<
+				so_5::mutable_msg<a_transform_manager_t::image_info_request_t>>(
+			req_handler_mbox,
+			std::move(req),
+			std::move(image_path),
+			&io_context );
+}
+
+//
+// handle_placeholder_op_request()
+//
+
+//! Handle a request for a tiny placeholder of an image.
+/*!
+ * The response is a data URI of a small JPEG image.
+ */
+void
+handle_placeholder_op_request(
+	const so_5::mbox_t & req_handler_mbox,
+	//! Limiter of active requests. Can be nullptr.
+	active_requests_limiter_t * limiter,
+	restinio::asio_ns::io_context & io_context,
+	restinio::request_handle_t req )
+{
+	active_request_guard_t active_request;
+	if( limiter )
+	{
+		auto guard = limiter->try_acquire();
+		if( !guard )
+		{
+			do_503_response( std::move( req ) );
+			return;
+		}
+		active_request = std::move( *guard );
+	}
+
+	std::string image_path{ req->header().path() };
+
+	so_5::send<
+				so_5::mutable_msg<a_transform_manager_t::placeholder_request_t>>(
+			req_handler_mbox,
+			std::move(req),
+			std::move(image_path),
+			std::move(active_request),
+			&io_context );
+}
+
 [[nodiscard]] bool
 has_illegal_path_components( restinio::string_view_t path ) noexcept
 {
@@ -120,66 +352,140 @@ has_illegal_path_components( restinio::string_view_t path ) noexcept
 	return npos != path.find( ".." ) || npos != path.find( "//" );
 }
 
-void
-add_transform_op_handler(
-	const app_params_t & app_params,
-	http_req_router_t & router,
+//
+// make_image_handler()
+//
+
+[[nodiscard]] http_request_handler_t::image_handler_t
+make_image_handler(
+	restinio::asio_ns::io_context & io_context,
+	std::shared_ptr< const app_params_t > app_params,
+	source_files_shared_ptr_t source_files,
+	std::shared_ptr< source_index_t > source_index,
+	std::shared_ptr< active_requests_limiter_t > limiter,
 	so_5::mbox_t req_handler_mbox )
 {
-	router.http_get(
-		R"(/:path(.*)\.:ext(.{3,4}))",
-			restinio::path2regex::options_t{}.strict( true ),
-			[req_handler_mbox, &app_params]( auto req, auto params )
+	return [&io_context, req_handler_mbox, app_params,
+			source_files, source_index, limiter](
+			restinio::request_handle_t req,
+			const image_route_t & route )
+		{
+			if( has_illegal_path_components( req->header().path() ) )
 			{
-				if( has_illegal_path_components( req->header().path() ) )
-				{
-					// Invalid path.
-					return do_400_response( std::move( req ) );
-				}
+				// Invalid path.
+				return do_400_response( std::move( req ) );
+			}
 
-				// Query params.
-				const auto qp = restinio::parse_query( req->header().query() );
-				const auto target_format = qp.get_param( "target-format"sv );
+			if( source_index &&
+					!source_index->may_exist( req->header().path() ) )
+			{
+				// There is no such source image, there is no need
+				// to bother the transformation manager.
+				return do_404_response( std::move( req ) );
+			}
 
-				const auto image_format = try_detect_target_image_format(
-						params[ "ext" ],
-						target_format );
-				if( !image_format )
-				{
-					// Target format of an image is unspecified or unknown.
-					return do_400_response( std::move( req ) );
-				}
+			// Query params.
+			const auto & version_param = app_params->m_caching.m_version_param;
+			const auto query = parse_image_query(
+					req->header().query(), version_param );
+			if( !query )
+				return do_400_response( std::move( req ) );
 
-				if( !qp.size() )
-				{
-					// No query string => serve original file.
-					return serve_as_regular_file(
-							app_params.m_storage.m_root_dir,
-							std::move( req ),
-							*image_format );
-				}
+			const auto target_format = query->m_target_format;
 
-				const auto operation = qp.get_param( "op"sv );
-				if( operation && "resize"sv != *operation )
-				{
-					// Only resize operation is supported.
+			// Preset must be known.
+			const auto & presets = app_params->m_presets.m_presets;
+			const preset_t * preset = nullptr;
+			if( const auto preset_name = query->m_preset )
+			{
+				const auto it = presets.find( *preset_name );
+				if( it == presets.end() )
 					return do_400_response( std::move( req ) );
-				}
+				preset = &it->second;
+			}
 
-				if( !operation && !target_format )
-				{
-					// op=resize or target-format=something must be defined.
-					return do_400_response( std::move( req ) );
-				}
+			const bool auto_format = app_params->m_transform.m_allow_auto &&
+					"auto"sv == target_format;
 
-				handle_resize_op_request(
-						req_handler_mbox,
+			// Format from the preset has the priority.
+			const auto image_format = preset && preset->m_format ?
+					preset->m_format :
+					auto_format ?
+					select_auto_image_format( *req, route.m_ext ) :
+					try_detect_target_image_format(
+							route.m_ext,
+							target_format );
+			if( !image_format )
+			{
+				// Target format of an image is unspecified or unknown.
+				return do_400_response( std::move( req ) );
+			}
+
+			// The version of an image doesn't affect the processing,
+			// it only makes the response immutable.
+			const bool versioned = query->m_versioned;
+
+			if( query->m_params_count == ( versioned ? 1u : 0u ) )
+			{
+				// No query string => serve original file.
+				return serve_as_regular_file(
+						*source_files,
+						std::move( req ),
 						*image_format,
-						qp,
+						make_caching_header_fields(
+								app_params->m_caching.m_originals,
+								versioned ) );
+			}
+
+			const auto operation = query->m_op;
+			if( operation && "info"sv == *operation )
+			{
+				handle_info_op_request(
+						req_handler_mbox,
+						io_context,
+						std::move( req ) );
+
+				return restinio::request_accepted();
+			}
+
+			if( operation && "placeholder"sv == *operation )
+			{
+				handle_placeholder_op_request(
+						req_handler_mbox,
+						limiter.get(),
+						io_context,
 						std::move( req ) );
 
 				return restinio::request_accepted();
-	} );
+			}
+
+			if( operation && "resize"sv != *operation )
+			{
+				// Only resize, info and placeholder operations are supported.
+				return do_400_response( std::move( req ) );
+			}
+
+			if( !operation && !target_format && !preset )
+			{
+				// op=resize, target-format=something or preset=name
+				// must be defined.
+				return do_400_response( std::move( req ) );
+			}
+
+			handle_resize_op_request(
+					req_handler_mbox,
+					*app_params,
+					preset,
+					*image_format,
+					versioned,
+					auto_format && !( preset && preset->m_format ),
+					*query,
+					limiter.get(),
+					io_context,
+					std::move( req ) );
+
+			return restinio::request_accepted();
+		};
 }
 
 void
@@ -191,6 +497,8 @@ add_delete_cache_handler(
 			"/cache",
 			[req_handler_mbox]( auto req, auto /*params*/ )
 			{
+				using request_t = a_transform_manager_t::delete_cache_request_t;
+
 				const auto qp = restinio::parse_query( req->header().query() );
 				auto token = qp.get_param( "token"sv );
 				if( !token )
@@ -198,11 +506,311 @@ add_delete_cache_handler(
 					return do_403_response( req, "No token provided\r\n" );
 				}
 
+				// Only one selector for images can be specified.
+				// All images are removed if there is no selector.
+				auto selector = request_t::selector_t::all;
+				std::string pattern;
+				for( const auto & [name, value] : {
+						std::make_pair( "path"sv, request_t::selector_t::path ),
+						std::make_pair( "prefix"sv, request_t::selector_t::prefix ),
+						std::make_pair( "glob"sv, request_t::selector_t::glob ) } )
+				{
+					if( const auto v = qp.get_param( name ) )
+					{
+						if( request_t::selector_t::all != selector || v->empty() )
+							return do_400_response( std::move( req ) );
+
+						selector = value;
+						// Paths of images always start with '/'.
+						if( '/' != v->front() )
+							pattern += '/';
+						pattern.append( v->data(), v->size() );
+					}
+				}
+
 				// Delegate request processing to transform_manager.
-				so_5::send< so_5::mutable_msg<a_transform_manager_t::delete_cache_request_t> >(
+				so_5::send< so_5::mutable_msg<request_t> >(
 						req_handler_mbox,
 						req,
-						restinio::cast_to<std::string>(*token) );
+						restinio::cast_to<std::string>(*token),
+						selector,
+						std::move(pattern) );
+
+				return restinio::request_accepted();
+			} );
+}
+
+//
+// add_prewarm_handlers()
+//
+
+//! Make a description of a requested image from its URL.
+/*!
+ * URL is a path with a query string in the same form as in requests
+ * for transformed images. Scheme and host can be present, they are
+ * ignored.
+ *
+ * Presets are handled in the same way as for usual requests. Requested
+ * size is rounded up to the ladder of sizes and canonicalized by
+ * the manager.
+ *
+ * \return empty value if URL is not a valid request for transformation.
+ */
+[[nodiscard]] std::optional< a_transform_manager_t::requested_image_t >
+try_make_requested_image(
+	const app_params_t & app_params,
+	std::string_view url )
+{
+	for( const auto scheme : { "http://"sv, "https://"sv } )
+		if( starts_with( url, scheme ) )
+		{
+			url.remove_prefix( scheme.size() );
+			const auto path_start = url.find( '/' );
+			if( std::string_view::npos == path_start )
+				return std::nullopt;
+			url.remove_prefix( path_start );
+		}
+
+	const auto query_start = url.find( '?' );
+	if( std::string_view::npos == query_start )
+		// Original images are not cached.
+		return std::nullopt;
+
+	const auto path = url.substr( 0, query_start );
+	const auto route = try_match_image_route( path );
+	if( !route || has_illegal_path_components( path ) )
+		return std::nullopt;
+
+	// The version of an image isn't a part of the key.
+	const auto query = parse_image_query( url.substr( query_start + 1u ), {} );
+	if( !query )
+		return std::nullopt;
+
+	// Preset must be known.
+	const auto & presets = app_params.m_presets.m_presets;
+	const preset_t * preset = nullptr;
+	if( const auto preset_name = query->m_preset )
+	{
+		const auto it = presets.find( *preset_name );
+		if( it == presets.end() )
+			return std::nullopt;
+		preset = &it->second;
+	}
+
+	const auto target_format = query->m_target_format;
+	const auto operation = query->m_op;
+	if( ( operation && "resize"sv != *operation ) ||
+			( !operation && !target_format && !preset ) )
+		return std::nullopt;
+
+	// Format from the preset has the priority.
+	const auto image_format = preset && preset->m_format ?
+			preset->m_format :
+			try_detect_target_image_format(
+					route->m_ext,
+					target_format );
+	if( !image_format )
+		return std::nullopt;
+
+	const auto resolved = resolve_resize_params(
+			app_params.m_presets,
+			preset,
+			transform::resize_params_t::make(
+					query_number( query->m_width ),
+					query_number( query->m_height ),
+					query_number( query->m_max ) ),
+			false );
+
+	return a_transform_manager_t::requested_image_t{
+			transform::resize_request_key_t{
+					std::string{ path },
+					*image_format,
+					resolved.m_params,
+					resolved.m_quality },
+			resolved.m_pinned,
+			// Sizes from presets are used as is.
+			!preset };
+}
+
+//! Make descriptions of requested images from URLs in the body of a request.
+/*!
+ * The body contains URLs of images, one URL per line. Empty lines and
+ * lines started with '#' are ignored.
+ *
+ * \return false if there is an invalid URL in the body.
+ */
+template < typename Image_Handler >
+[[nodiscard]] bool
+try_parse_image_urls(
+	const app_params_t & app_params,
+	std::string_view body,
+	Image_Handler && image_handler )
+{
+	while( !body.empty() )
+	{
+		const auto eol = std::min( body.find( '\n' ), body.size() );
+		auto line = body.substr( 0, eol );
+		body.remove_prefix( std::min( eol + 1u, body.size() ) );
+
+		const auto first = line.find_first_not_of( " \t\r" );
+		if( std::string_view::npos == first || '#' == line[ first ] )
+			continue;
+		line = line.substr( first,
+				line.find_last_not_of( " \t\r" ) + 1u - first );
+
+		// URLs can be sent back in header fields.
+		if( line.end() != std::find_if( line.begin(), line.end(),
+				[]( unsigned char ch ) { return ch < 0x20u || 0x7fu == ch; } ) )
+			return false;
+
+		try
+		{
+			auto image = try_make_requested_image( app_params, line );
+			if( !image )
+				return false;
+
+			image_handler( line, std::move(*image) );
+		}
+		catch( const std::exception & )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+add_prewarm_handlers(
+	http_req_router_t & router,
+	std::shared_ptr< const app_params_t > app_params,
+	so_5::mbox_t req_handler_mbox )
+{
+	// The body contains URLs of images to be transformed.
+	router.http_post(
+			"/cache/prewarm",
+			[req_handler_mbox, app_params]( auto req, auto /*params*/ )
+			{
+				const auto qp = restinio::parse_query( req->header().query() );
+				auto token = qp.get_param( "token"sv );
+				if( !token )
+				{
+					return do_403_response( req, "No token provided\r\n" );
+				}
+
+				std::vector< a_transform_manager_t::requested_image_t > images;
+				if( !try_parse_image_urls( *app_params, req->body(),
+						[&images]( std::string_view, auto image ) {
+							images.push_back( std::move(image) );
+						} ) )
+					return do_400_response( std::move( req ) );
+
+				if( images.empty() )
+					return do_400_response( std::move( req ) );
+
+				so_5::send< so_5::mutable_msg<a_transform_manager_t::prewarm_request_t> >(
+						req_handler_mbox,
+						req,
+						restinio::cast_to<std::string>(*token),
+						std::move(images) );
+
+				return restinio::request_accepted();
+			} );
+
+	router.http_get(
+			R"(/cache/prewarm/:id(\d{1,18}))",
+			[req_handler_mbox]( auto req, auto params )
+			{
+				const auto qp = restinio::parse_query( req->header().query() );
+				auto token = qp.get_param( "token"sv );
+				if( !token )
+				{
+					return do_403_response( req, "No token provided\r\n" );
+				}
+
+				so_5::send< so_5::mutable_msg<a_transform_manager_t::prewarm_status_request_t> >(
+						req_handler_mbox,
+						req,
+						restinio::cast_to<std::string>(*token),
+						restinio::cast_to<std::uint64_t>( params[ "id" ] ) );
+
+				return restinio::request_accepted();
+			} );
+}
+
+//
+// add_rendition_batch_handler()
+//
+
+//! Max count of images in one batch of renditions.
+constexpr std::size_t max_rendition_batch_size{ 32u };
+
+void
+add_rendition_batch_handler(
+	http_req_router_t & router,
+	restinio::asio_ns::io_context & io_context,
+	std::shared_ptr< const app_params_t > app_params,
+	std::shared_ptr< source_index_t > source_index,
+	std::shared_ptr< active_requests_limiter_t > limiter,
+	so_5::mbox_t req_handler_mbox )
+{
+	// The body contains URLs of images in the same form as for prewarm.
+	// Images are sent back as `multipart/mixed` in the same order.
+	router.http_post(
+			"/batch",
+			[&io_context, req_handler_mbox, app_params, source_index, limiter](
+				auto req, auto /*params*/ )
+			{
+				using item_t = a_transform_manager_t::rendition_batch_item_t;
+
+				// The limit is checked before the parsing of the body,
+				// so an overloaded server doesn't spend time on it.
+				std::optional< active_request_guard_t > first_slot;
+				if( limiter )
+				{
+					first_slot = limiter->try_acquire();
+					if( !first_slot )
+						return do_503_response( std::move( req ) );
+				}
+
+				std::vector< item_t > items;
+				if( !try_parse_image_urls( *app_params, req->body(),
+						[&]( std::string_view url, auto image ) {
+							// There is no need to bother workers with
+							// images which don't exist.
+							const bool missing = source_index &&
+									!source_index->may_exist( image.m_key.path() );
+							items.push_back( item_t{
+									std::string{ url },
+									std::move(image),
+									missing,
+									active_request_guard_t{} } );
+						} ) )
+					return do_400_response( std::move( req ) );
+
+				if( items.empty() || max_rendition_batch_size < items.size() )
+					return do_400_response( std::move( req ) );
+
+				// Every image takes its own slot like a usual request.
+				// Slots already taken are released if the limit is reached.
+				if( limiter )
+				{
+					items.front().m_active_request = std::move( *first_slot );
+					for( auto it = std::next( items.begin() );
+							it != items.end(); ++it )
+					{
+						auto guard = limiter->try_acquire();
+						if( !guard )
+							return do_503_response( std::move( req ) );
+						it->m_active_request = std::move( *guard );
+					}
+				}
+
+				so_5::send< so_5::mutable_msg<a_transform_manager_t::rendition_batch_request_t> >(
+						req_handler_mbox,
+						req,
+						std::move(items),
+						&io_context );
 
 				return restinio::request_accepted();
 			} );
@@ -210,17 +818,38 @@ add_delete_cache_handler(
 
 } /* namespace anonymous */
 
-std::unique_ptr< http_req_router_t >
+std::unique_ptr< http_request_handler_t >
 make_router(
+	restinio::asio_ns::io_context & io_context,
 	const app_params_t & params,
+	source_files_shared_ptr_t source_files,
+	std::shared_ptr< source_index_t > source_index,
+	std::shared_ptr< active_requests_limiter_t > limiter,
 	so_5::mbox_t req_handler_mbox )
 {
-	auto router = std::make_unique< http_req_router_t >();
+	const auto app_params = std::make_shared< const app_params_t >( params );
 
-	add_transform_op_handler( params, *router, req_handler_mbox );
+	// Express router is used for rare requests only.
+	auto router = std::make_unique< http_req_router_t >();
 	add_delete_cache_handler( *router, req_handler_mbox );
+	add_prewarm_handlers( *router, app_params, req_handler_mbox );
+	add_rendition_batch_handler(
+			*router,
+			io_context,
+			app_params,
+			source_index,
+			limiter,
+			req_handler_mbox );
 
-	return router;
+	return std::make_unique< http_request_handler_t >(
+			make_image_handler(
+					io_context,
+					app_params,
+					std::move(source_files),
+					std::move(source_index),
+					std::move(limiter),
+					req_handler_mbox ),
+			std::move(router) );
 }
 
 } /* namespace shrimp */
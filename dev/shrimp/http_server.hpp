@@ -6,8 +6,17 @@
 	Http server for receiving requests.
 */
 
+#include <functional>
+#include <memory>
+
+#include <sys/socket.h>
+
 #include <shrimp/common_types.hpp>
+#include <shrimp/active_requests_limiter.hpp>
 #include <shrimp/app_params.hpp>
+#include <shrimp/image_route.hpp>
+#include <shrimp/source_files.hpp>
+#include <shrimp/source_index.hpp>
 
 #include <so_5/all.hpp>
 
@@ -38,6 +47,47 @@ using http_req_router_t =
 				// Max capture groups for regex.
 				5 > > >;
 
+//
+// http_request_handler_t
+//
+
+//! Request handler used in application.
+/*!
+	Requests for images are the hot path, so they are matched by
+	try_match_image_route() without regexes and allocations. All other
+	requests are passed to the express router.
+*/
+class http_request_handler_t
+{
+	public:
+		//! Handler for GET requests for images.
+		using image_handler_t = std::function<
+				restinio::request_handling_status_t(
+						restinio::request_handle_t,
+						const image_route_t & ) >;
+
+		http_request_handler_t(
+			image_handler_t image_handler,
+			std::unique_ptr< http_req_router_t > fallback_router )
+			:	m_image_handler{ std::move( image_handler ) }
+			,	m_fallback_router{ std::move( fallback_router ) }
+		{}
+
+		restinio::request_handling_status_t
+		operator()( restinio::request_handle_t req ) const
+		{
+			if( restinio::http_method_get() == req->header().method() )
+				if( const auto route = try_match_image_route( req->header().path() ) )
+					return m_image_handler( std::move( req ), *route );
+
+			return ( *m_fallback_router )( std::move( req ) );
+		}
+
+	private:
+		const image_handler_t m_image_handler;
+		const std::unique_ptr< http_req_router_t > m_fallback_router;
+};
+
 //
 // http_server_logger_t
 //
@@ -111,24 +161,34 @@ struct http_server_traits_t
 	:	public restinio::default_traits_t
 {
 	using logger_t = http_server_logger_t;
-	using request_handler_t = http_req_router_t;
+	using request_handler_t = http_request_handler_t;
 };
 
-std::unique_ptr< http_req_router_t >
+std::unique_ptr< http_request_handler_t >
 make_router(
+	//! Context of the server. Responses from the manager are made on it.
+	restinio::asio_ns::io_context & io_context,
 	const app_params_t & params,
+	source_files_shared_ptr_t source_files,
+	//! Index of source images. Can be nullptr.
+	std::shared_ptr< source_index_t > source_index,
+	//! Limiter shared by all servers. Can be nullptr.
+	std::shared_ptr< active_requests_limiter_t > limiter,
 	so_5::mbox_t req_handler_mbox );
 
-//
-// make_http_server_settings()
-//
+namespace http_server_details {
 
-//! Tune Shrimp HTTP-server settings to use with restinio::run.
-[[nodiscard]] inline auto
-make_http_server_settings(
-	unsigned int thread_pool_size,
+//! Set parameters which are the same for all kinds of servers.
+template < typename Settings >
+void
+setup_http_server_settings(
+	Settings & settings,
+	restinio::asio_ns::io_context & io_context,
 	const app_params_t & params,
 	std::shared_ptr<spdlog::logger> logger,
+	source_files_shared_ptr_t source_files,
+	std::shared_ptr< source_index_t > source_index,
+	std::shared_ptr< active_requests_limiter_t > limiter,
 	so_5::mbox_t req_handler_mbox )
 {
 	const auto ip_protocol = [](auto ip_ver) {
@@ -139,15 +199,117 @@ make_http_server_settings(
 
 	const auto & http_srv_params = params.m_http_server;
 
-	return restinio::on_thread_pool< http_server_traits_t >( thread_pool_size )
+	settings
 			.port( http_srv_params.m_port )
 			.protocol( ip_protocol(http_srv_params.m_ip_version) )
 			.address( http_srv_params.m_address )
-			// NOTE: it is better to configure that value.
-			.handle_request_timeout( std::chrono::seconds(60) )
-			.write_http_response_timelimit( std::chrono::seconds(60) )
+			.read_next_http_message_timelimit( http_srv_params.m_read_timeout )
+			.handle_request_timeout( http_srv_params.m_handle_request_timeout )
+			.write_http_response_timelimit( http_srv_params.m_write_timeout )
+			.buffer_size( http_srv_params.m_buffer_size )
+			.max_pipelined_requests( http_srv_params.m_max_pipelined_requests )
+			.concurrent_accepts_count( http_srv_params.m_concurrent_accepts )
+			.socket_options_setter(
+				[tcp_nodelay = http_srv_params.m_tcp_nodelay,
+					send_buffer_size = http_srv_params.m_send_buffer_size](
+						restinio::socket_options_t & options )
+				{
+					if( tcp_nodelay )
+						options.set_option(
+								restinio::asio_ns::ip::tcp::no_delay( true ) );
+					if( 0u != send_buffer_size )
+						options.set_option(
+								restinio::asio_ns::socket_base::send_buffer_size(
+										static_cast< int >( send_buffer_size ) ) );
+				} )
 			.logger( std::move(logger) )
-			.request_handler( make_router( params, req_handler_mbox ) );
+			.request_handler( make_router(
+					io_context,
+					params,
+					std::move(source_files),
+					std::move(source_index),
+					std::move(limiter),
+					std::move(req_handler_mbox) ) );
+}
+
+} /* namespace http_server_details */
+
+//
+// make_http_server_settings()
+//
+
+//! Tune Shrimp HTTP-server settings to use with restinio::run.
+[[nodiscard]] inline auto
+make_http_server_settings(
+	unsigned int thread_pool_size,
+	//! Context which is passed to restinio::run.
+	restinio::asio_ns::io_context & io_context,
+	const app_params_t & params,
+	std::shared_ptr<spdlog::logger> logger,
+	source_files_shared_ptr_t source_files,
+	std::shared_ptr< source_index_t > source_index,
+	std::shared_ptr< active_requests_limiter_t > limiter,
+	so_5::mbox_t req_handler_mbox )
+{
+	auto settings = restinio::on_thread_pool< http_server_traits_t >(
+			thread_pool_size );
+	http_server_details::setup_http_server_settings(
+			settings,
+			io_context,
+			params,
+			std::move(logger),
+			std::move(source_files),
+			std::move(source_index),
+			std::move(limiter),
+			std::move(req_handler_mbox) );
+
+	return settings;
+}
+
+//
+// make_reuseport_http_server_settings()
+//
+
+//! Tune settings for one of servers which share the same port.
+/*!
+	The server has its own context with exactly one thread.
+	The listening socket is bound with SO_REUSEPORT, so several such
+	servers can listen the same address and port.
+*/
+[[nodiscard]] inline auto
+make_reuseport_http_server_settings(
+	//! Context which is passed to restinio::run.
+	restinio::asio_ns::io_context & io_context,
+	const app_params_t & params,
+	std::shared_ptr<spdlog::logger> logger,
+	source_files_shared_ptr_t source_files,
+	std::shared_ptr< source_index_t > source_index,
+	std::shared_ptr< active_requests_limiter_t > limiter,
+	so_5::mbox_t req_handler_mbox )
+{
+	using reuse_port_t = restinio::asio_ns::detail::socket_option::boolean<
+			SOL_SOCKET, SO_REUSEPORT >;
+
+	auto settings = restinio::on_thread_pool< http_server_traits_t >( 1u );
+	http_server_details::setup_http_server_settings(
+			settings,
+			io_context,
+			params,
+			std::move(logger),
+			std::move(source_files),
+			std::move(source_index),
+			std::move(limiter),
+			std::move(req_handler_mbox) );
+
+	settings.acceptor_options_setter(
+			[]( restinio::acceptor_options_t & options ) {
+				// The same as the default setter does.
+				options.set_option(
+						restinio::asio_ns::socket_base::reuse_address( true ) );
+				options.set_option( reuse_port_t( true ) );
+			} );
+
+	return settings;
 }
 
 } /* namespace shrimp */
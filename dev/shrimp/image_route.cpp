@@ -0,0 +1,104 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Matching of requests for images without regexes.
+ */
+
+#include <shrimp/image_route.hpp>
+
+#include <array>
+#include <utility>
+
+using namespace std::literals;
+
+namespace shrimp {
+
+//
+// try_match_image_route()
+//
+
+[[nodiscard]] std::optional< image_route_t >
+try_match_image_route( std::string_view path ) noexcept
+{
+	if( path.empty() || '/' != path.front() )
+		return std::nullopt;
+
+	for( const std::size_t ext_size : { 3u, 4u } )
+	{
+		// The leading '/' and the dot must be present too.
+		if( path.size() < ext_size + 2u )
+			break;
+
+		const auto dot = path.size() - ext_size - 1u;
+		if( '.' == path[ dot ] )
+			return image_route_t{
+					path.substr( 1u, dot - 1u ),
+					path.substr( dot + 1u ) };
+	}
+
+	return std::nullopt;
+}
+
+//
+// parse_image_query()
+//
+
+[[nodiscard]] std::optional< image_query_t >
+parse_image_query(
+	std::string_view query,
+	std::string_view version_param ) noexcept
+{
+	image_query_t result;
+
+	const std::array< std::pair<
+				std::string_view,
+				std::optional< std::string_view > image_query_t::* >, 6 >
+			known_params{ {
+				{ "op"sv, &image_query_t::m_op },
+				{ "width"sv, &image_query_t::m_width },
+				{ "height"sv, &image_query_t::m_height },
+				{ "max"sv, &image_query_t::m_max },
+				{ "target-format"sv, &image_query_t::m_target_format },
+				{ "preset"sv, &image_query_t::m_preset } } };
+
+	while( !query.empty() )
+	{
+		const auto amp = query.find( '&' );
+		const auto item = query.substr( 0, amp );
+		query.remove_prefix(
+				std::string_view::npos == amp ? query.size() : amp + 1u );
+
+		if( item.empty() )
+			continue;
+
+		const auto eq = item.find( '=' );
+		if( std::string_view::npos == eq || 0u == eq )
+			return std::nullopt;
+
+		const auto key = item.substr( 0, eq );
+		const auto value = item.substr( eq + 1u );
+		++result.m_params_count;
+
+		if( !version_param.empty() && version_param == key )
+		{
+			result.m_versioned = true;
+			continue;
+		}
+
+		for( const auto & [name, field] : known_params )
+			if( name == key )
+			{
+				if( !( result.*field ) )
+					result.*field = value;
+				break;
+			}
+	}
+
+	return result;
+}
+
+} /* namespace shrimp */
+
@@ -0,0 +1,102 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Matching of requests for images without regexes.
+ *
+ * Requests for images are the most frequent ones. They are matched
+ * and parsed by hand-written code which doesn't allocate memory.
+ * All values are views into the path and the query string of a request.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace shrimp {
+
+//
+// image_route_t
+//
+
+//! Parts of the path of a request for an image.
+/*!
+ * It is the same as the result of the route `/:path(.*)\.:ext(.{3,4})`
+ * of the express router.
+ */
+struct image_route_t
+{
+	//! Path without the leading '/' and the extension.
+	std::string_view m_path;
+	//! Extension of the image without the dot.
+	std::string_view m_ext;
+};
+
+//
+// try_match_image_route()
+//
+
+//! Split the path of a request to the path of an image and its extension.
+/*!
+ * The extension has 3 or 4 chars. The shortest extension is preferred
+ * as the greedy `(.*)` of the express route does.
+ *
+ * \return empty value if the path isn't a path of an image.
+ */
+[[nodiscard]] std::optional< image_route_t >
+try_match_image_route( std::string_view path ) noexcept;
+
+//
+// image_query_t
+//
+
+//! Parameters from the query string of a request for an image.
+/*!
+ * Only parameters used by Shrimp are stored. Other parameters are
+ * only counted.
+ *
+ * \note Keys and values aren't percent-decoded. Values of all known
+ * parameters are numbers and names which don't need encoding.
+ */
+struct image_query_t
+{
+	std::optional< std::string_view > m_op;
+	std::optional< std::string_view > m_width;
+	std::optional< std::string_view > m_height;
+	std::optional< std::string_view > m_max;
+	std::optional< std::string_view > m_target_format;
+	std::optional< std::string_view > m_preset;
+
+	//! Is the parameter with the version of the image present?
+	bool m_versioned{ false };
+
+	//! Count of all parameters including unknown ones.
+	std::size_t m_params_count{ 0u };
+};
+
+//
+// parse_image_query()
+//
+
+//! Parse the query string of a request for an image.
+/*!
+ * If a parameter is repeated then the first value is used.
+ * Empty items (like in `a=1&&b=2`) are ignored.
+ *
+ * \return empty value if there is an item without '=' or with
+ * an empty key.
+ */
+[[nodiscard]] std::optional< image_query_t >
+parse_image_query(
+	//! Query string without '?'.
+	std::string_view query,
+	//! Name of the parameter with the version of the image.
+	//! Can be empty if versions aren't used.
+	std::string_view version_param ) noexcept;
+
+} /* namespace shrimp */
+
@@ -14,6 +14,7 @@
 #include <list>
 #include <chrono>
 #include <optional>
+#include <vector>
 
 namespace shrimp {
 
@@ -34,7 +35,7 @@ class key_multivalue_queue_t
 
 	struct wrapped_value_t;
 
-	using map_t = std::multimap<Key, wrapped_value_t>;
+	using map_t = std::multimap<Key, wrapped_value_t, std::less<>>;
 
 	struct access_info_t
 	{
@@ -161,6 +162,27 @@ public :
 			return std::nullopt;
 	}
 
+	// Select items starting from the first one which key is not less
+	// than \a from. Items are selected in the order of keys while
+	// \a in_range returns true for the key of an item.
+	//
+	// Bound can be of any type comparable with Key.
+	//
+	// Note: this method is not const because the obtained tokens can be
+	// used for container modification later.
+	template<typename Bound, typename Predicate>
+	[[nodiscard]] std::vector< access_token_t >
+	select_from( const Bound & from, Predicate && in_range )
+	{
+		std::vector< access_token_t > result;
+		for( auto it = m_items.lower_bound( from );
+				it != m_items.end() && in_range( it->first );
+				++it )
+			result.push_back( access_token_t{ it } );
+
+		return result;
+	}
+
 	void
 	erase( access_token_t atoken ) noexcept
 	{
@@ -212,6 +234,21 @@ public :
 			return std::nullopt;
 	}
 
+	// Find the oldest item which key satisfies \a predicate.
+	//
+	// Note: this method is not const because the obtained token can be
+	// used for container modification later.
+	template<typename Predicate>
+	[[nodiscard]] std::optional< access_token_t >
+	oldest_if( Predicate && predicate )
+	{
+		for( const auto & info : m_access_info )
+			if( predicate( info.m_value_it->first ) )
+				return access_token_t{ info.m_value_it };
+
+		return std::nullopt;
+	}
+
 	template<typename L>
 	void
 	extract_values_for_key(
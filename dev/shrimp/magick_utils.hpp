@@ -0,0 +1,76 @@
+/*
+	Shrimp
+*/
+
+/*!
+	Helpers for working with MagickCore API directly.
+*/
+
+#pragma once
+
+#include <memory>
+
+#include <Magick++.h>
+
+namespace shrimp
+{
+
+namespace magick
+{
+
+namespace details
+{
+
+struct exception_info_deleter_t
+{
+	void
+	operator()( MagickCore::ExceptionInfo * p ) const noexcept
+	{
+		MagickCore::DestroyExceptionInfo( p );
+	}
+};
+
+struct image_info_deleter_t
+{
+	void
+	operator()( MagickCore::ImageInfo * p ) const noexcept
+	{
+		MagickCore::DestroyImageInfo( p );
+	}
+};
+
+struct custom_stream_deleter_t
+{
+	void
+	operator()( MagickCore::CustomStreamInfo * p ) const noexcept
+	{
+		MagickCore::DestroyCustomStreamInfo( p );
+	}
+};
+
+} /* namespace details */
+
+//! Owner of MagickCore::ExceptionInfo object.
+using exception_info_unique_ptr_t = std::unique_ptr<
+		MagickCore::ExceptionInfo,
+		details::exception_info_deleter_t >;
+
+//! Owner of MagickCore::ImageInfo object.
+using image_info_unique_ptr_t = std::unique_ptr<
+		MagickCore::ImageInfo,
+		details::image_info_deleter_t >;
+
+//! Owner of MagickCore::CustomStreamInfo object.
+using custom_stream_unique_ptr_t = std::unique_ptr<
+		MagickCore::CustomStreamInfo,
+		details::custom_stream_deleter_t >;
+
+[[nodiscard]] inline exception_info_unique_ptr_t
+make_exception_info()
+{
+	return exception_info_unique_ptr_t{ MagickCore::AcquireExceptionInfo() };
+}
+
+} /* namespace magick */
+
+} /* namespace shrimp */
@@ -0,0 +1,171 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Named presets for transformations.
+ */
+
+#include <shrimp/presets.hpp>
+
+#include <charconv>
+
+namespace shrimp {
+
+namespace /* anonymous */
+{
+
+//! Get the next comma-separated item from the description.
+[[nodiscard]] std::string_view
+next_item( std::string_view & description )
+{
+	const auto comma = description.find( ',' );
+	const auto item = description.substr( 0, comma );
+	description.remove_prefix(
+			std::string_view::npos == comma ? description.size() : comma + 1u );
+
+	return item;
+}
+
+[[nodiscard]] std::uint32_t
+parse_number( std::string_view what, std::string_view owner_name )
+{
+	std::uint32_t result{};
+	const auto [ptr, ec] = std::from_chars(
+			what.data(), what.data() + what.size(), result );
+	if( std::errc{} != ec || what.data() + what.size() != ptr )
+		throw exception_t{ "invalid number '{}' in '{}'", what, owner_name };
+
+	return result;
+}
+
+//! Try to use an item as a directive for Cache-Control.
+/*!
+ * \return false if the item isn't a directive for Cache-Control.
+ */
+[[nodiscard]] bool
+try_apply_cache_control_item(
+	cache_control_policy_t & policy,
+	std::string_view key,
+	std::string_view value,
+	std::string_view owner_name )
+{
+	std::optional< std::uint32_t > * directive = nullptr;
+	if( "max-age" == key )
+		directive = &policy.m_max_age;
+	else if( "s-maxage" == key )
+		directive = &policy.m_s_maxage;
+	else if( "stale-while-revalidate" == key )
+		directive = &policy.m_stale_while_revalidate;
+	else
+		return false;
+
+	*directive = parse_number( value, owner_name );
+	return true;
+}
+
+} /* anonymous namespace */
+
+//
+// parse_preset()
+//
+
+[[nodiscard]] std::pair< std::string, preset_t >
+parse_preset( std::string_view description )
+{
+	const auto eq = description.find( '=' );
+	if( std::string_view::npos == eq || 0u == eq )
+		throw exception_t{ "preset name is missing: '{}'", description };
+
+	const auto name = description.substr( 0, eq );
+	description.remove_prefix( eq + 1u );
+
+	// The first item is mode and value.
+	const auto size_item = next_item( description );
+	const auto colon = size_item.find( ':' );
+	if( std::string_view::npos == colon )
+		throw exception_t{ "invalid size '{}' in preset '{}'", size_item, name };
+
+	const auto mode = size_item.substr( 0, colon );
+	const auto value = parse_number( size_item.substr( colon + 1u ), name );
+
+	std::optional< std::uint32_t > width, height, max_side;
+	if( "width" == mode )
+		width = value;
+	else if( "height" == mode )
+		height = value;
+	else if( "max" == mode )
+		max_side = value;
+	else
+		throw exception_t{ "invalid mode '{}' in preset '{}'", mode, name };
+
+	preset_t preset{
+			transform::resize_params_t::make( width, height, max_side ),
+			std::nullopt,
+			0u,
+			false,
+			cache_control_policy_t{} };
+	transform::resize_params_constraints_t{}.check( preset.m_params );
+
+	// All other items are optional.
+	while( !description.empty() )
+	{
+		const auto item = next_item( description );
+		const auto item_eq = item.find( '=' );
+		const auto key = item.substr( 0, item_eq );
+		const auto item_value = std::string_view::npos == item_eq ?
+				std::string_view{} : item.substr( item_eq + 1u );
+
+		if( "pinned" == key && std::string_view::npos == item_eq )
+			preset.m_pinned = true;
+		else if( "format" == key )
+		{
+			preset.m_format = image_format_from_extension( item_value );
+			if( !preset.m_format )
+				throw exception_t{ "invalid format '{}' in preset '{}'",
+						item_value, name };
+		}
+		else if( "quality" == key )
+		{
+			preset.m_quality = parse_number( item_value, name );
+			if( 0u == preset.m_quality || 100u < preset.m_quality )
+				throw exception_t{ "quality must be in range [1, 100] "
+						"in preset '{}'", name };
+		}
+		else if( !try_apply_cache_control_item(
+				preset.m_cache_control, key, item_value, name ) )
+			throw exception_t{ "invalid parameter '{}' in preset '{}'",
+					item, name };
+	}
+
+	return { std::string{ name }, preset };
+}
+
+//
+// parse_cache_control_policy()
+//
+
+[[nodiscard]] cache_control_policy_t
+parse_cache_control_policy( std::string_view description )
+{
+	const std::string_view owner_name{ "cache-control policy" };
+
+	cache_control_policy_t policy;
+	while( !description.empty() )
+	{
+		const auto item = next_item( description );
+		const auto item_eq = item.find( '=' );
+		if( std::string_view::npos == item_eq ||
+				!try_apply_cache_control_item(
+						policy,
+						item.substr( 0, item_eq ),
+						item.substr( item_eq + 1u ),
+						owner_name ) )
+			throw exception_t{ "invalid directive '{}' in {}", item, owner_name };
+	}
+
+	return policy;
+}
+
+} /* namespace shrimp */
@@ -0,0 +1,93 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Named presets for transformations.
+ */
+
+#pragma once
+
+#include <shrimp/transforms.hpp>
+#include <shrimp/http_helpers.hpp>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace shrimp {
+
+//
+// preset_t
+//
+
+//! Parameters of transformation selected by name.
+/*!
+ * A client uses a preset by its name: `?preset=thumb`.
+ */
+struct preset_t
+{
+	//! Resize parameters.
+	transform::resize_params_t m_params;
+	//! Target format.
+	/*!
+	 * If empty then target format is detected from the request
+	 * as usual (from target-format parameter or from the extension).
+	 */
+	std::optional< image_format_t > m_format;
+	//! Quality for the encoder. Value 0 means the default quality.
+	std::uint32_t m_quality{ 0u };
+	//! Should transformed images be kept in the cache permanently?
+	bool m_pinned{ false };
+	//! Policy for `Cache-Control` header field.
+	/*!
+	 * If empty then the policy for transformed images is used.
+	 */
+	cache_control_policy_t m_cache_control{};
+};
+
+//! Type of container for presets.
+using presets_t = std::map< std::string, preset_t, std::less<> >;
+
+//
+// parse_preset()
+//
+
+//! Parse a description of a preset.
+/*!
+ * Description has the form:
+ * \code
+ * name=mode:value[,format=ext][,quality=N][,pinned][,max-age=N]
+ *     [,s-maxage=N][,stale-while-revalidate=N]
+ * \endcode
+ * where mode is one of width, height or max. For example:
+ * \code
+ * thumb=width:128,format=webp,quality=75,pinned
+ * \endcode
+ *
+ * Throws in case of error.
+ */
+[[nodiscard]] std::pair< std::string, preset_t >
+parse_preset( std::string_view description );
+
+//
+// parse_cache_control_policy()
+//
+
+//! Parse a description of a policy for `Cache-Control` header field.
+/*!
+ * Description has the form:
+ * \code
+ * [max-age=N][,s-maxage=N][,stale-while-revalidate=N]
+ * \endcode
+ * Values are in seconds. Empty description means no policy.
+ *
+ * Throws in case of error.
+ */
+[[nodiscard]] cache_control_policy_t
+parse_cache_control_policy( std::string_view description );
+
+} /* namespace shrimp */
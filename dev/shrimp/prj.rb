@@ -19,10 +19,18 @@ MxxRu::Cpp::lib_target {
 	# Define your target name here.
 	target 'lib/shrimp'
 
+	cpp_source 'common_types.cpp'
+	cpp_source 'source_files.cpp'
+	cpp_source 'source_index.cpp'
 	cpp_source 'transforms.cpp'
+	cpp_source 'presets.cpp'
+	cpp_source 'image_route.cpp'
+	cpp_source 'http_helpers.cpp'
 	cpp_source 'response_common.cpp'
 	cpp_source 'http_server.cpp'
 	cpp_source 'a_transform_manager.cpp'
 	cpp_source 'a_transformer.cpp'
+	cpp_source 'a_source_prefetcher.cpp'
+	cpp_source 'a_source_watcher.cpp'
 }
 
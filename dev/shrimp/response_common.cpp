@@ -3,8 +3,13 @@
 */
 
 #include <shrimp/response_common.hpp>
+#include <shrimp/http_helpers.hpp>
 #include <shrimp/utils.hpp>
 
+#include <fcntl.h>
+
+using namespace std::literals;
+
 namespace shrimp
 {
 
@@ -48,8 +53,213 @@ image_content_type_from_img_format( image_format_t img_format )
 	throw exception_t{ "undefined image type" };
 }
 
+//! Send 304 response with validators of the resource.
+restinio::request_handling_status_t
+do_not_modified_response(
+	restinio::request_handle_t req,
+	std::string etag,
+	std::string last_modified_value,
+	//! Header fields which would be sent with the full response.
+	header_fields_list_t header_fields )
+{
+	header_fields.emplace_back( restinio::http_field::etag, std::move( etag ) );
+	header_fields.emplace_back(
+			restinio::http_field::last_modified,
+			std::move( last_modified_value ) );
+
+	return do_304_response( std::move( req ), std::move( header_fields ) );
+}
+
+//! Max count of ranges in one request.
+/*!
+ * Requests with more ranges are served as usual requests.
+ */
+constexpr std::size_t max_ranges_in_request = 16u;
+
+//! A part of a blob sent as a body of a response without copying.
+struct blob_slice_t
+{
+	blob_slice_t(
+		datasizable_blob_shared_ptr_t blob,
+		std::size_t offset,
+		std::size_t size )
+		:	m_blob{ std::move(blob) }
+		,	m_offset{ offset }
+		,	m_size{ size }
+	{}
+
+	const void *
+	data() const noexcept
+	{
+		return static_cast< const char * >( m_blob->data() ) + m_offset;
+	}
+
+	std::size_t
+	size() const noexcept
+	{
+		return m_size;
+	}
+
+	//! The blob must live until the response is sent.
+	const datasizable_blob_shared_ptr_t m_blob;
+	const std::size_t m_offset;
+	const std::size_t m_size;
+};
+
+//! Send 416 response for unsatisfiable ranges.
+restinio::request_handling_status_t
+do_416_response(
+	restinio::request_handle_t req,
+	std::uint64_t resource_size )
+{
+	return response_common_details::make_response_object(
+				req, restinio::status_range_not_satisfiable(),
+				response_common_details::connection_status_t::autodetect )
+			.append_header(
+				restinio::http_field::content_range,
+				fmt::format( "bytes */{}", resource_size ) )
+			.done();
+}
+
+//! Get ranges requested by a client.
+/*!
+ * \return empty value if the whole resource should be sent.
+ * Empty vector if ranges aren't satisfiable.
+ */
+[[nodiscard]] std::optional< std::vector< byte_range_t > >
+requested_ranges(
+	const restinio::request_t & req,
+	std::string_view etag,
+	std::chrono::system_clock::time_point last_modified,
+	std::uint64_t resource_size )
+{
+	const auto range = try_get_header_field( req, restinio::http_field::range );
+	if( !range )
+		return std::nullopt;
+
+	// If the resource was changed the whole new version must be sent.
+	const auto if_range = try_get_header_field(
+			req, restinio::http_field::if_range );
+	if( if_range && !if_range_matches( *if_range, etag, last_modified ) )
+		return std::nullopt;
+
+	return parse_byte_ranges( *range, resource_size, max_ranges_in_request );
+}
+
+//! Set ranges of a resource as the body of a response.
+/*!
+ * One range is sent as is, several ranges are sent as
+ * `multipart/byteranges`.
+ */
+template < typename Response, typename Make_Body_Part >
+void
+set_ranges_body(
+	Response & resp,
+	const std::vector< byte_range_t > & ranges,
+	std::uint64_t resource_size,
+	std::string_view content_type,
+	Make_Body_Part && make_body_part )
+{
+	if( 1u == ranges.size() )
+	{
+		resp.append_header(
+				restinio::http_field::content_range,
+				make_content_range_value( ranges.front(), resource_size ) )
+			.append_header( restinio::http_field::content_type,
+				std::string{ content_type } )
+			.set_body( make_body_part( ranges.front() ) );
+		return;
+	}
+
+	// Images never contain this string in practice.
+	static constexpr std::string_view boundary{ "3d6b6a416f9b5_shrimp_byteranges" };
+
+	resp.append_header(
+			restinio::http_field::content_type,
+			fmt::format( "multipart/byteranges; boundary={}", boundary ) );
+
+	for( const auto & range : ranges )
+	{
+		resp.append_body( fmt::format(
+				"\r\n--{}\r\nContent-Type: {}\r\nContent-Range: {}\r\n\r\n",
+				boundary,
+				content_type,
+				make_content_range_value( range, resource_size ) ) );
+		resp.append_body( make_body_part( range ) );
+	}
+
+	resp.append_body( fmt::format( "\r\n--{}--\r\n", boundary ) );
+}
+
 } /* anonymous namespace */
 
+//
+// try_get_header_field()
+//
+
+[[nodiscard]] std::optional< std::string_view >
+try_get_header_field(
+	const restinio::request_t & req,
+	restinio::http_field_t field )
+{
+	if( !req.header().has_field( field ) )
+		return std::nullopt;
+
+	return std::string_view{ req.header().get_field( field ) };
+}
+
+//
+// is_client_copy_current()
+//
+
+[[nodiscard]] bool
+is_client_copy_current(
+	const restinio::request_t & req,
+	std::string_view etag,
+	std::chrono::system_clock::time_point last_modified )
+{
+	return is_not_modified(
+			try_get_header_field( req, restinio::http_field::if_none_match ),
+			try_get_header_field( req, restinio::http_field::if_modified_since ),
+			etag,
+			last_modified );
+}
+
+//
+// make_caching_header_fields()
+//
+
+[[nodiscard]] header_fields_list_t
+make_caching_header_fields(
+	const cache_control_policy_t & policy,
+	bool immutable )
+{
+	header_fields_list_t result;
+
+	auto cache_control = make_cache_control_value( policy, immutable );
+	if( cache_control.empty() )
+		return result;
+
+	result.emplace_back(
+			restinio::http_field::cache_control,
+			std::move( cache_control ) );
+
+	// Expires is for old HTTP/1.0 caches.
+	const auto max_age = immutable ? immutable_max_age : policy.m_max_age;
+	if( max_age )
+		result.emplace_back(
+				restinio::http_field::expires,
+				format_http_date(
+						std::chrono::system_clock::now() +
+						std::chrono::seconds{ *max_age } ) );
+
+	return result;
+}
+
+//
+// serve_transformed_image()
+//
+
 void
 serve_transformed_image(
 	restinio::request_handle_t req,
@@ -58,26 +268,110 @@ serve_transformed_image(
 	http_header::image_src_t image_src,
 	header_fields_list_t header_fields )
 {
-	auto resp = req->create_response();
+	if( is_client_copy_current(
+			*req, blob->m_etag, blob->m_last_modified_at ) )
+	{
+		do_not_modified_response(
+				std::move( req ),
+				blob->m_etag,
+				blob->m_last_modified_value,
+				std::move( header_fields ) );
+		return;
+	}
+
+	const auto ranges = requested_ranges(
+			*req, blob->m_etag, blob->m_last_modified_at, blob->size() );
+	if( ranges && ranges->empty() )
+	{
+		do_416_response( std::move( req ), blob->size() );
+		return;
+	}
 
+	auto resp = req->create_response(
+			ranges ? restinio::status_partial_content() : restinio::status_ok() );
+
+	// All values are formatted once, when the blob is created.
 	set_common_header_fields_for_image_resp(
-			blob->m_last_modified_at,
+			blob->m_last_modified_value,
 			resp )
-		.append_header(
-			restinio::http_field::content_type,
-			image_content_type_from_img_format( img_format )  )
+		.append_header( restinio::http_field::etag, blob->m_etag )
 		.append_header(
 			restinio::http_header_field_t{
 				http_header::shrimp_image_src_hf(),
 				image_src_to_str( image_src )
-			} )
-		.set_body( std::move( blob ) );
+			} );
 
 	for( auto & hf : header_fields )
 	{
 		resp.append_header( std::move( hf ) );
 	}
 
+	const auto content_type = image_content_type_from_img_format( img_format );
+	if( ranges )
+	{
+		// Parts of the blob are sent without copying.
+		set_ranges_body( resp, *ranges, blob->size(), content_type,
+				[&blob]( const byte_range_t & range ) {
+					return std::make_shared< blob_slice_t >(
+							blob,
+							static_cast< std::size_t >( range.m_first ),
+							static_cast< std::size_t >( range.m_size ) );
+				} );
+	}
+	else
+	{
+		resp.append_header( restinio::http_field::content_type, content_type )
+			.set_body( std::move( blob ) );
+	}
+
+	resp.done();
+}
+
+//
+// serve_renditions()
+//
+
+void
+serve_renditions(
+	restinio::request_handle_t req,
+	renditions_t renditions )
+{
+	auto resp = response_common_details::make_response_object(
+			req, restinio::status_ok(),
+			response_common_details::connection_status_t::autodetect );
+
+	// Images never contain this string in practice.
+	static constexpr std::string_view boundary{ "3d6b6a416f9b5_shrimp_renditions" };
+
+	resp.append_header(
+			restinio::http_field::content_type,
+			fmt::format( "multipart/mixed; boundary={}", boundary ) );
+
+	for( auto & rendition : renditions )
+	{
+		resp.append_body( fmt::format(
+				"\r\n--{}\r\nContent-Location: {}\r\n{}: {}\r\n",
+				boundary,
+				rendition.m_url,
+				http_header::shrimp_status_hf(),
+				rendition.m_status ) );
+
+		if( !rendition.m_blob )
+		{
+			resp.append_body( "\r\n"s );
+			continue;
+		}
+
+		resp.append_body( fmt::format(
+				"Content-Type: {}\r\nETag: {}\r\nLast-Modified: {}\r\n\r\n",
+				image_content_type_from_img_format( rendition.m_format ),
+				rendition.m_blob->m_etag,
+				rendition.m_blob->m_last_modified_value ) );
+		// The image is sent without copying.
+		resp.append_body( std::move( rendition.m_blob ) );
+	}
+
+	resp.append_body( fmt::format( "\r\n--{}--\r\n", boundary ) );
 	resp.done();
 }
 
@@ -87,33 +381,77 @@ serve_transformed_image(
 
 [[nodiscard]] restinio::request_handling_status_t
 serve_as_regular_file(
-	const std::string & root_dir,
+	source_files_t & source_files,
 	restinio::request_handle_t req,
-	image_format_t image_format )
+	image_format_t image_format,
+	header_fields_list_t header_fields )
 {
-	const auto full_path =
-		make_full_path( root_dir, req->header().path() );
-
 	try
 	{
-		auto sf = restinio::sendfile( full_path );
-		const auto last_modified = sf.meta().last_modified_at();
+		auto source = source_files.open( req->header().path() );
+		if( !source )
+			return do_404_response( std::move( req ) );
+
+		const auto last_modified = source->m_stat.m_last_modified_at;
+		const auto file_size = source->m_stat.m_size;
+		auto etag = source->m_stat.etag();
+		if( is_client_copy_current( *req, etag, last_modified ) )
+			return do_not_modified_response(
+					std::move( req ),
+					std::move( etag ),
+					format_http_date( last_modified ),
+					std::move( header_fields ) );
 
-		auto resp = req->create_response();
+		const auto ranges = requested_ranges(
+				*req, etag, last_modified, file_size );
+		if( ranges && ranges->empty() )
+			return do_416_response( std::move( req ), file_size );
 
-		return set_common_header_fields_for_image_resp(
-					last_modified,
+		auto resp = req->create_response(
+				ranges ? restinio::status_partial_content() : restinio::status_ok() );
+
+		set_common_header_fields_for_image_resp(
+					format_http_date( last_modified ),
 					resp )
-				.append_header(
-					restinio::http_field::content_type,
-					image_content_type_from_img_format( image_format ) )
+				.append_header( restinio::http_field::etag, std::move( etag ) )
 				.append_header(
 					restinio::http_header_field_t{
 						http_header::shrimp_image_src_hf(),
 						image_src_to_str( http_header::image_src_t::sendfile )
-					} )
-				.set_body( std::move( sf ) )
-				.done();
+					} );
+
+		for( auto & hf : header_fields )
+			resp.append_header( std::move( hf ) );
+
+		const auto content_type = image_content_type_from_img_format( image_format );
+		const restinio::file_meta_t file_meta{ file_size, last_modified };
+		if( ranges )
+		{
+			// Every part needs its own descriptor because
+			// the descriptor is closed when the part is sent.
+			set_ranges_body( resp, *ranges, file_size, content_type,
+					[&]( const byte_range_t & range ) {
+						unique_fd_t fd{ ::fcntl(
+								source->m_fd.get(), F_DUPFD_CLOEXEC, 0 ) };
+						if( !fd )
+							throw exception_t{ "unable to duplicate descriptor" };
+
+						return restinio::sendfile(
+								restinio::file_descriptor_holder_t{ fd.release() },
+								file_meta )
+							.offset_and_size( range.m_first, range.m_size );
+					} );
+		}
+		else
+		{
+			resp.append_header( restinio::http_field::content_type, content_type )
+				.set_body( restinio::sendfile(
+						restinio::file_descriptor_holder_t{
+								source->m_fd.release() },
+						file_meta ) );
+		}
+
+		return resp.done();
 	}
 	catch(...)
 	{
@@ -11,6 +11,8 @@
 #include <restinio/all.hpp>
 
 #include <shrimp/common_types.hpp>
+#include <shrimp/http_helpers.hpp>
+#include <shrimp/source_files.hpp>
 #include <shrimp/utils.hpp>
 
 namespace shrimp
@@ -25,7 +27,9 @@ inline RESP &
 set_common_header_fields( RESP & resp )
 {
 	resp.append_header( restinio::http_field_t::server, "Shrimp draft server" );
-	resp.append_header_date_field();
+	// Formatting of the current time is too expensive to do it
+	// for every response.
+	resp.append_header( restinio::http_field_t::date, current_http_date() );
 
 	return resp;
 }
@@ -37,19 +41,21 @@ set_common_header_fields( RESP & resp )
 template < typename RESP >
 inline RESP &
 set_common_header_fields_for_image_resp(
-	std::chrono::system_clock::time_point last_modified,
+	//! Already formatted value for `Last-Modified` header field.
+	std::string last_modified_value,
 	RESP & resp  )
 {
 	set_common_header_fields( resp )
 		.append_header(
 				restinio::http_field_t::last_modified,
-				restinio::make_date_field_value( last_modified ) )
+				std::move( last_modified_value ) )
+		.append_header( restinio::http_field_t::accept_ranges, "bytes" )
 		.append_header(
 				restinio::http_field_t::access_control_allow_origin, "*" )
 		.append_header(
 				"Access-Control-Expose-Headers",
 				"Shrimp-Processing-Time, Shrimp-Resize-Time, "
-				"Shrimp-Encoding-Time, Shrimp-Image-Src" );
+				"Shrimp-Encoding-Time, Shrimp-Image-Src, Shrimp-Actual-Size" );
 
 	return resp;
 }
@@ -162,6 +168,30 @@ do_200_plaintext_response(
 		.set_body( std::move(body_content) )
 		.done();
 }
+
+//
+// do_200_json_response()
+//
+
+inline auto
+do_200_json_response(
+	restinio::request_handle_t req,
+	std::string body_content )
+{
+	return
+		response_common_details::make_response_object(
+				req, restinio::status_ok(),
+				response_common_details::connection_status_t::autodetect )
+		.append_header(
+				restinio::http_field::content_type,
+				"application/json" )
+		.append_header(
+				restinio::http_field::access_control_allow_origin, "*" )
+		.append_header( restinio::http_field::cache_control, "no-cache" )
+		.set_body( std::move(body_content) )
+		.done();
+}
+
 //
 // do_503_response()
 //
@@ -223,6 +253,50 @@ make_header_fields_list(
 	return result;
 }
 
+//
+// do_304_response()
+//
+
+inline auto
+do_304_response(
+	restinio::request_handle_t req,
+	header_fields_list_t header_fields )
+{
+	auto resp = response_common_details::make_response_object(
+			req, restinio::status_not_modified(),
+			response_common_details::connection_status_t::autodetect );
+
+	for( auto & hf : header_fields )
+		resp.append_header( std::move( hf ) );
+
+	return resp.done();
+}
+
+//
+// try_get_header_field()
+//
+
+//! Get a value of a header field of a request if it is present.
+[[nodiscard]] std::optional< std::string_view >
+try_get_header_field(
+	const restinio::request_t & req,
+	restinio::http_field_t field );
+
+//
+// is_client_copy_current()
+//
+
+//! Check conditional header fields of a request.
+/*!
+ * \return true if the client already has the current version of
+ * the resource and the response with 304 status code should be sent.
+ */
+[[nodiscard]] bool
+is_client_copy_current(
+	const restinio::request_t & req,
+	std::string_view etag,
+	std::chrono::system_clock::time_point last_modified );
+
 namespace http_header
 {
 
@@ -242,6 +316,25 @@ shrimp_encoding_time_hf() { return { "Shrimp-Encoding-Time" }; }
 inline constexpr std::string_view
 shrimp_image_src_hf() { return "Shrimp-Image-Src"; }
 
+//! The size used for transformation if it differs from the requested one.
+[[nodiscard]]
+inline constexpr std::string_view
+shrimp_actual_size_hf() { return "Shrimp-Actual-Size"; }
+
+//! Status code for one image from a batch of renditions.
+[[nodiscard]]
+inline constexpr std::string_view
+shrimp_status_hf() { return "Shrimp-Status"; }
+
+//! Client hints used for `width=auto`.
+[[nodiscard]]
+inline constexpr std::string_view
+client_hints_list()
+{
+	return "Width, DPR, Viewport-Width, "
+			"Sec-CH-Width, Sec-CH-DPR, Sec-CH-Viewport-Width";
+}
+
 //! Server image source.
 enum class image_src_t
 {
@@ -252,6 +345,20 @@ enum class image_src_t
 
 } /* namespace http_header */
 
+//
+// make_caching_header_fields()
+//
+
+//! Make `Cache-Control` and `Expires` header fields for a response.
+/*!
+ * \return empty list if there is no policy.
+ */
+[[nodiscard]] header_fields_list_t
+make_caching_header_fields(
+	const cache_control_policy_t & policy,
+	//! Does the URL contain a version of the image?
+	bool immutable );
+
 //
 // serve_transformed_image()
 //
@@ -264,6 +371,43 @@ serve_transformed_image(
 	http_header::image_src_t image_src,
 	header_fields_list_t header_fields = {} );
 
+//
+// rendition_t
+//
+
+//! Result for one image from a batch of renditions.
+struct rendition_t
+{
+	//! URL of the image from the batch request.
+	std::string m_url;
+	//! Format of the image.
+	image_format_t m_format;
+	//! Status code for this image.
+	/*!
+	 * Value 0 means that the image isn't handled yet.
+	 */
+	std::uint16_t m_status{ 0u };
+	//! The image. Is empty if it can't be provided.
+	datasizable_blob_shared_ptr_t m_blob;
+};
+
+using renditions_t = std::vector< rendition_t >;
+
+//
+// serve_renditions()
+//
+
+//! Send images from a batch as `multipart/mixed` response.
+/*!
+ * Parts go in the same order as images in the request. Every part has
+ * `Content-Location` with the URL of the image and `Shrimp-Status` with
+ * the status code for that image. Only parts with status 200 have a body.
+ */
+void
+serve_renditions(
+	restinio::request_handle_t req,
+	renditions_t renditions );
+
 //
 // serve_as_regular_file()
 //
@@ -271,9 +415,10 @@ serve_transformed_image(
 [[nodiscard]]
 restinio::request_handling_status_t
 serve_as_regular_file(
-	const std::string & root_dir,
+	source_files_t & source_files,
 	restinio::request_handle_t req,
-	image_format_t image_format );
+	image_format_t image_format,
+	header_fields_list_t header_fields = {} );
 
 } /* namespace shrimp */
 
@@ -0,0 +1,462 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Access to source images inside the storage root directory.
+ */
+
+#include <shrimp/source_files.hpp>
+#include <shrimp/common_types.hpp>
+#include <shrimp/magick_utils.hpp>
+#include <shrimp/utils.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace shrimp {
+
+namespace /* anonymous */
+{
+
+//! Make a path relative to the root directory from a path from URL.
+[[nodiscard]] std::string
+make_relative_path( std::string_view path )
+{
+	const auto first = path.find_first_not_of( '/' );
+	if( std::string_view::npos == first )
+		return {};
+
+	path.remove_prefix( first );
+	return std::string{ path.data(), path.size() };
+}
+
+//! Read information about an image from its header only.
+/*!
+ * Name of the image is used as a hint for detection of image format.
+ *
+ * \return empty value if the image can't be read or has
+ * unsupported format.
+ */
+[[nodiscard]] std::optional< source_image_info_t >
+ping_image(
+	std::string_view image_name,
+	const void * data,
+	std::size_t size )
+{
+	auto exception = magick::make_exception_info();
+	magick::image_info_unique_ptr_t image_info{
+			MagickCore::AcquireImageInfo() };
+
+	const std::string filename{ image_name };
+	MagickCore::CopyMagickString(
+			image_info->filename,
+			filename.c_str(),
+			MagickPathExtent );
+
+	auto * pinged = MagickCore::PingBlob(
+			image_info.get(), data, size, exception.get() );
+	if( !pinged )
+		return std::nullopt;
+
+	// Magick::Image takes the ownership of the image.
+	const Magick::Image image{ pinged };
+	const auto format = image_format_from_magick( image.magick() );
+	if( !format )
+		return std::nullopt;
+
+	return source_image_info_t{
+			*format,
+			static_cast< std::uint32_t >( image.columns() ),
+			static_cast< std::uint32_t >( image.rows() ) };
+}
+
+[[nodiscard]] source_file_stat_t
+make_source_file_stat( const struct stat & st )
+{
+	using namespace std::chrono;
+
+	source_file_stat_t result;
+	result.m_size = static_cast< std::uint64_t >( st.st_size );
+	result.m_mtime_ns = static_cast< std::int64_t >( st.st_mtim.tv_sec ) *
+			1000000000 + st.st_mtim.tv_nsec;
+	result.m_last_modified_at = system_clock::time_point{
+			duration_cast< system_clock::duration >(
+					nanoseconds{ result.m_mtime_ns } ) };
+	result.m_device = static_cast< std::uint64_t >( st.st_dev );
+	result.m_inode = static_cast< std::uint64_t >( st.st_ino );
+
+	return result;
+}
+
+[[nodiscard]] source_file_stat_t
+fstat_source_file( int fd )
+{
+	struct stat st;
+	if( 0 != ::fstat( fd, &st ) )
+		throw exception_t{ "fstat failed: {}", std::strerror( errno ) };
+
+	return make_source_file_stat( st );
+}
+
+//! Read the beginning of a file.
+/*!
+ * \return count of bytes read. It is less than \a size only if
+ * the file is shorter.
+ */
+[[nodiscard]] std::size_t
+pread_prefix( int fd, char * buffer, std::size_t size )
+{
+	std::size_t offset = 0u;
+	while( offset < size )
+	{
+		const auto r = ::pread( fd, buffer + offset, size - offset,
+				static_cast< off_t >( offset ) );
+		if( r < 0 )
+		{
+			if( EINTR == errno )
+				continue;
+			throw exception_t{ "pread failed: {}", std::strerror( errno ) };
+		}
+		if( 0 == r )
+			break;
+
+		offset += static_cast< std::size_t >( r );
+	}
+
+	return offset;
+}
+
+[[nodiscard]] std::int64_t
+steady_now_ticks() noexcept
+{
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+} /* anonymous namespace */
+
+//
+// unique_fd_t
+//
+unique_fd_t::~unique_fd_t()
+{
+	if( 0 <= m_fd )
+		::close( m_fd );
+}
+
+//
+// source_content_t
+//
+source_content_t::source_content_t( int fd )
+	:	m_stat{ fstat_source_file( fd ) }
+	,	m_size{ static_cast< std::size_t >( m_stat.m_size ) }
+{
+	if( !m_size )
+		throw exception_t{ "unable to read an empty file" };
+
+	m_data.reset( new char[ m_size ] );
+
+	std::size_t offset = 0u;
+	while( offset < m_size )
+	{
+		const auto r = ::pread( fd, m_data.get() + offset, m_size - offset,
+				static_cast< off_t >( offset ) );
+		if( r < 0 )
+		{
+			if( EINTR == errno )
+				continue;
+			throw exception_t{ "pread failed: {}", std::strerror( errno ) };
+		}
+		if( 0 == r )
+			throw exception_t{ "source file was truncated during reading" };
+
+		offset += static_cast< std::size_t >( r );
+	}
+
+	// The file could be rewritten in place during the reading.
+	if( !fstat_source_file( fd ).same_file( m_stat ) )
+		throw exception_t{ "source file was changed during reading" };
+}
+
+//
+// source_files_t::cached_source_t
+//
+struct source_files_t::cached_source_t
+{
+	//! Descriptor for the opened file.
+	const unique_fd_t m_fd;
+	//! Stat-information obtained at the opening time.
+	const source_file_stat_t m_stat;
+
+	//! When the stat-information was checked the last time.
+	std::atomic< std::int64_t > m_checked_at{ steady_now_ticks() };
+
+	cached_source_t( unique_fd_t fd, source_file_stat_t stat )
+		:	m_fd{ std::move(fd) }
+		,	m_stat{ stat }
+	{}
+};
+
+//
+// source_files_t
+//
+source_files_t::source_files_t( const storage_params_t & params )
+	:	m_root_fd{ ::open(
+			params.m_root_dir.c_str(),
+			O_PATH | O_DIRECTORY | O_CLOEXEC ) }
+	,	m_max_open_files{ std::max< std::size_t >( 1u, params.m_max_open_files ) }
+{
+	if( !m_root_fd )
+		throw exception_t{ "unable to open images directory {}: {}",
+				params.m_root_dir,
+				std::strerror( errno ) };
+}
+
+source_files_t::~source_files_t() = default;
+
+[[nodiscard]] std::optional< opened_source_t >
+source_files_t::open( std::string_view path )
+{
+	auto source = find_or_open( path );
+	if( !source )
+		return std::nullopt;
+
+	// Every user receives its own descriptor, the cached one
+	// stays in the cache.
+	unique_fd_t fd{ ::fcntl( source->m_fd.get(), F_DUPFD_CLOEXEC, 0 ) };
+	if( !fd )
+		return std::nullopt;
+
+	return opened_source_t{ std::move(fd), source->m_stat };
+}
+
+[[nodiscard]] source_content_shared_ptr_t
+source_files_t::read( std::string_view path )
+{
+	auto source = find_or_open( path );
+	if( !source )
+		throw exception_t{ "unable to open source file: {}", path };
+
+	// The content is read by pread(), so the shared descriptor
+	// can be used from several threads.
+	return std::make_shared< source_content_t >( source->m_fd.get() );
+}
+
+[[nodiscard]] std::optional< source_file_stat_t >
+source_files_t::stat( std::string_view path )
+{
+	auto source = find_or_open( path );
+	if( !source )
+		return std::nullopt;
+
+	return source->m_stat;
+}
+
+[[nodiscard]] std::optional< source_image_info_t >
+source_files_t::image_info( std::string_view path )
+{
+	// Stat-information is necessary for detection of replaced files.
+	auto source = find_or_open( path );
+	if( !source )
+		return std::nullopt;
+
+	const auto relative_path = make_relative_path( path );
+
+	std::lock_guard< std::mutex > lock{ m_lock };
+	auto atoken = m_image_infos.lookup( relative_path );
+	if( !atoken )
+		return std::nullopt;
+
+	if( !atoken->value().m_stat.same_file( source->m_stat ) )
+	{
+		m_image_infos.erase( *atoken );
+		return std::nullopt;
+	}
+
+	m_image_infos.update_access_time( *atoken );
+	return atoken->value().m_info;
+}
+
+[[nodiscard]] std::optional< source_image_info_t >
+source_files_t::read_image_info( std::string_view path )
+{
+	if( auto info = image_info( path ) )
+		return info;
+
+	try
+	{
+		const auto source = find_or_open( path );
+		if( !source )
+			return std::nullopt;
+
+		// Headers of images are at the beginning of files, so only
+		// a prefix of the file is read.
+		const auto prefix_capacity = static_cast< std::size_t >(
+				std::min< std::uint64_t >(
+						source->m_stat.m_size, image_header_read_size ) );
+		std::unique_ptr< char[] > prefix{ new char[ prefix_capacity ] };
+		const auto prefix_size = pread_prefix(
+				source->m_fd.get(), prefix.get(), prefix_capacity );
+
+		auto info = ping_image( path, prefix.get(), prefix_size );
+		if( !info && prefix_size < source->m_stat.m_size )
+		{
+			// The header can be too big for the prefix (for example,
+			// if there is a large embedded profile).
+			const auto content = read( path );
+			info = ping_image( path, content->data(), content->size() );
+		}
+
+		if( info )
+			remember_image_info( path, source->m_stat, *info );
+
+		return info;
+	}
+	catch( const std::exception & )
+	{
+		return std::nullopt;
+	}
+}
+
+void
+source_files_t::remember_image_info(
+	std::string_view path,
+	const source_file_stat_t & stat,
+	const source_image_info_t & info )
+{
+	auto relative_path = make_relative_path( path );
+	if( relative_path.empty() )
+		return;
+
+	std::lock_guard< std::mutex > lock{ m_lock };
+	if( auto atoken = m_image_infos.lookup( relative_path ) )
+		m_image_infos.erase( *atoken );
+
+	m_image_infos.insert(
+			std::move(relative_path),
+			known_image_info_t{ stat, info } );
+
+	while( m_image_infos.size() > max_image_infos )
+		m_image_infos.erase( m_image_infos.oldest().value() );
+}
+
+void
+source_files_t::forget( std::string_view path )
+{
+	const auto relative_path = make_relative_path( path );
+
+	std::lock_guard< std::mutex > lock{ m_lock };
+	if( auto atoken = m_cache.lookup( relative_path ) )
+		m_cache.erase( *atoken );
+	if( auto atoken = m_image_infos.lookup( relative_path ) )
+		m_image_infos.erase( *atoken );
+}
+
+void
+source_files_t::forget_directory( std::string_view dir )
+{
+	auto prefix = make_relative_path( dir );
+	if( !prefix.empty() && '/' != prefix.back() )
+		prefix += '/';
+
+	std::lock_guard< std::mutex > lock{ m_lock };
+	const auto outdated = m_cache.select_from( prefix,
+			[&prefix]( const std::string & p ) { return starts_with( p, prefix ); } );
+	for( const auto & atoken : outdated )
+		m_cache.erase( atoken );
+
+	const auto outdated_infos = m_image_infos.select_from( prefix,
+			[&prefix]( const std::string & p ) { return starts_with( p, prefix ); } );
+	for( const auto & atoken : outdated_infos )
+		m_image_infos.erase( atoken );
+}
+
+[[nodiscard]] source_files_t::cached_source_shared_ptr_t
+source_files_t::find_or_open( std::string_view path )
+{
+	auto relative_path = make_relative_path( path );
+	if( relative_path.empty() )
+		return {};
+
+	cached_source_shared_ptr_t source;
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		if( auto atoken = m_cache.lookup( relative_path ) )
+		{
+			m_cache.update_access_time( *atoken );
+			source = atoken->value();
+		}
+	}
+
+	if( source && is_still_valid( relative_path, *source ) )
+		return source;
+
+	// File isn't opened yet or it was replaced.
+	source = try_open( relative_path );
+
+	std::lock_guard< std::mutex > lock{ m_lock };
+	if( auto atoken = m_cache.lookup( relative_path ) )
+		m_cache.erase( *atoken );
+
+	if( source )
+	{
+		m_cache.insert(
+				std::move(relative_path),
+				cached_source_shared_ptr_t{ source } );
+
+		while( m_cache.size() > m_max_open_files )
+			m_cache.erase( m_cache.oldest().value() );
+	}
+
+	return source;
+}
+
+[[nodiscard]] source_files_t::cached_source_shared_ptr_t
+source_files_t::try_open( const std::string & relative_path ) const
+{
+	unique_fd_t fd{ ::openat(
+			m_root_fd.get(),
+			relative_path.c_str(),
+			O_RDONLY | O_CLOEXEC ) };
+	if( !fd )
+		return {};
+
+	struct stat st;
+	if( 0 != ::fstat( fd.get(), &st ) || !S_ISREG( st.st_mode ) )
+		return {};
+
+	return std::make_shared< cached_source_t >(
+			std::move(fd),
+			make_source_file_stat( st ) );
+}
+
+[[nodiscard]] bool
+source_files_t::is_still_valid(
+	const std::string & relative_path,
+	cached_source_t & source ) const
+{
+	const auto now = steady_now_ticks();
+	const auto border = now - std::chrono::duration_cast<
+			std::chrono::steady_clock::duration >( revalidation_period ).count();
+	if( source.m_checked_at.load( std::memory_order_relaxed ) > border )
+		return true;
+
+	struct stat st;
+	if( 0 != ::fstatat( m_root_fd.get(), relative_path.c_str(), &st, 0 ) )
+		return false;
+
+	if( !source.m_stat.same_file( make_source_file_stat( st ) ) )
+		return false;
+
+	source.m_checked_at.store( now, std::memory_order_relaxed );
+	return true;
+}
+
+} /* namespace shrimp */
@@ -0,0 +1,338 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief Access to source images inside the storage root directory.
+ */
+
+#pragma once
+
+#include <shrimp/app_params.hpp>
+#include <shrimp/cache_alike_container.hpp>
+#include <shrimp/common_types.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace shrimp {
+
+//
+// source_file_stat_t
+//
+
+//! Stat-information about a source file.
+struct source_file_stat_t
+{
+	//! Size of the file in bytes.
+	std::uint64_t m_size{};
+	//! The last modification time of the file.
+	std::chrono::system_clock::time_point m_last_modified_at{};
+
+	//! Identity of the file. Used for detection of replaced files.
+	std::uint64_t m_device{};
+	std::uint64_t m_inode{};
+	std::int64_t m_mtime_ns{};
+
+	[[nodiscard]] bool
+	same_file( const source_file_stat_t & o ) const noexcept
+	{
+		return m_device == o.m_device && m_inode == o.m_inode &&
+				m_size == o.m_size && m_mtime_ns == o.m_mtime_ns;
+	}
+
+	//! Value for `ETag` http header field.
+	/*!
+	 * It is made from the identity of the file, so it is changed
+	 * if the file is changed or replaced.
+	 */
+	[[nodiscard]] std::string
+	etag() const
+	{
+		return fmt::format( "\"{:x}-{:x}-{:x}\"",
+				m_inode, m_size, m_mtime_ns );
+	}
+};
+
+//
+// source_image_info_t
+//
+
+//! Information about a source image obtained during its decoding.
+struct source_image_info_t
+{
+	//! Actual format of the image.
+	image_format_t m_format;
+	std::uint32_t m_width;
+	std::uint32_t m_height;
+};
+
+//
+// unique_fd_t
+//
+
+//! An owner of a file descriptor.
+/*!
+ * \note This is Moveable type, not Copyable.
+ */
+class unique_fd_t
+{
+public:
+	unique_fd_t() = default;
+	explicit unique_fd_t( int fd ) noexcept : m_fd{ fd } {}
+
+	unique_fd_t( const unique_fd_t & ) = delete;
+	unique_fd_t & operator=( const unique_fd_t & ) = delete;
+
+	unique_fd_t( unique_fd_t && o ) noexcept
+		:	m_fd{ o.release() }
+	{}
+
+	unique_fd_t &
+	operator=( unique_fd_t && o ) noexcept
+	{
+		unique_fd_t tmp{ std::move(o) };
+		std::swap( m_fd, tmp.m_fd );
+		return *this;
+	}
+
+	~unique_fd_t();
+
+	[[nodiscard]] int
+	get() const noexcept { return m_fd; }
+
+	[[nodiscard]] explicit
+	operator bool() const noexcept { return 0 <= m_fd; }
+
+	//! Release the ownership of the descriptor.
+	[[nodiscard]] int
+	release() noexcept
+	{
+		const auto fd = m_fd;
+		m_fd = -1;
+		return fd;
+	}
+
+private:
+	int m_fd{ -1 };
+};
+
+//
+// source_content_t
+//
+
+//! The whole content of a source file read into a private buffer.
+/*!
+ * The file isn't mapped into memory. If a file is truncated or rewritten
+ * in place while it is being read then the reading fails with an
+ * exception. A decoder can't get SIGBUS because of such changes.
+ */
+class source_content_t
+{
+public:
+	//! Throws if the file can't be read completely or if it was
+	//! changed during the reading.
+	explicit source_content_t( int fd );
+
+	source_content_t( const source_content_t & ) = delete;
+	source_content_t & operator=( const source_content_t & ) = delete;
+
+	[[nodiscard]] const void *
+	data() const noexcept { return m_data.get(); }
+
+	[[nodiscard]] std::size_t
+	size() const noexcept { return m_size; }
+
+	//! Stat-information of the file at the time of reading.
+	[[nodiscard]] const source_file_stat_t &
+	stat() const noexcept { return m_stat; }
+
+private:
+	source_file_stat_t m_stat;
+	std::size_t m_size;
+	std::unique_ptr< char[] > m_data;
+};
+
+using source_content_shared_ptr_t = std::shared_ptr< const source_content_t >;
+
+//
+// opened_source_t
+//
+
+//! A source file opened for reading.
+struct opened_source_t
+{
+	//! A personal descriptor for the file.
+	unique_fd_t m_fd;
+	//! Stat-information for the file.
+	source_file_stat_t m_stat;
+};
+
+//
+// source_files_t
+//
+
+/*!
+ * \brief Access layer for source images.
+ *
+ * Holds a descriptor for the root directory of the image storage and
+ * resolves paths to source images relative to it by openat().
+ *
+ * Descriptors of opened files (together with stat-information) are
+ * stored in LRU cache. So the repeated requests to hot images don't do
+ * path walks and open/close operations. The content of a file is read
+ * anew for every user, it isn't shared between revalidations.
+ *
+ * Cached stat-information is periodically revalidated. A file is reopened
+ * if it was replaced.
+ *
+ * Information about source images (format and dimensions) is stored
+ * in a separate LRU cache. It is filled by transformers and is bound to
+ * the identity of the file, so information about a replaced file is
+ * never returned.
+ *
+ * \note This class is thread-safe.
+ */
+class source_files_t
+{
+public:
+	//! Throws if the root directory can't be opened.
+	source_files_t( const storage_params_t & params );
+	~source_files_t();
+
+	source_files_t( const source_files_t & ) = delete;
+	source_files_t & operator=( const source_files_t & ) = delete;
+
+	//! Open a source file for sending it as is.
+	/*!
+	 * \return empty value if the file can't be opened.
+	 */
+	[[nodiscard]] std::optional< opened_source_t >
+	open( std::string_view path );
+
+	//! Read the whole content of a source file.
+	/*!
+	 * Throws if the file can't be opened or read.
+	 */
+	[[nodiscard]] source_content_shared_ptr_t
+	read( std::string_view path );
+
+	//! Get stat-information for a source file.
+	/*!
+	 * \return empty value if the file can't be opened.
+	 */
+	[[nodiscard]] std::optional< source_file_stat_t >
+	stat( std::string_view path );
+
+	//! Get information about a source image if it is known.
+	/*!
+	 * \return empty value if the image wasn't decoded yet or if
+	 * the file was changed after that.
+	 */
+	[[nodiscard]] std::optional< source_image_info_t >
+	image_info( std::string_view path );
+
+	//! Get information about a source image reading it if necessary.
+	/*!
+	 * If the information isn't known yet only the beginning of the file
+	 * is read and only the header of the image is parsed (the image isn't
+	 * decoded). The whole file is read only if the header can't be parsed
+	 * from its beginning. The information is remembered for the next
+	 * calls.
+	 *
+	 * \return empty value if the file can't be read or if it isn't
+	 * an image of a supported format.
+	 */
+	[[nodiscard]] std::optional< source_image_info_t >
+	read_image_info( std::string_view path );
+
+	//! Store information about a decoded source image.
+	void
+	remember_image_info(
+		std::string_view path,
+		//! Stat-information of the file from that the image was decoded.
+		const source_file_stat_t & stat,
+		const source_image_info_t & info );
+
+	//! Remove information about a file from the cache.
+	/*!
+	 * Should be called when the file is known to be changed or removed.
+	 * Users which already got the descriptor or the content of the file
+	 * still can use them.
+	 */
+	void
+	forget( std::string_view path );
+
+	//! Remove information about all files inside a directory.
+	/*!
+	 * Empty \a dir means the whole storage.
+	 */
+	void
+	forget_directory( std::string_view dir );
+
+private:
+	struct cached_source_t;
+	using cached_source_shared_ptr_t = std::shared_ptr< cached_source_t >;
+
+	using cache_t = cache_alike_container_t<
+			std::string,
+			cached_source_shared_ptr_t >;
+
+	struct known_image_info_t
+	{
+		source_file_stat_t m_stat;
+		source_image_info_t m_info;
+	};
+
+	using image_infos_t = cache_alike_container_t<
+			std::string,
+			known_image_info_t >;
+
+	//! Max count of source images information about that is stored.
+	static constexpr std::size_t max_image_infos{ 64u * 1024u };
+
+	//! Size of the beginning of a file read for parsing of the header.
+	static constexpr std::size_t image_header_read_size{ 64u * 1024u };
+
+	//! Interval after that stat-information must be checked again.
+	static constexpr std::chrono::seconds revalidation_period{ 1 };
+
+	//! Descriptor of the root directory (opened with O_PATH).
+	unique_fd_t m_root_fd;
+
+	//! Max count of opened files in the cache.
+	const std::size_t m_max_open_files;
+
+	std::mutex m_lock;
+
+	//! Cache of opened files.
+	cache_t m_cache;
+
+	//! Information about decoded source images.
+	image_infos_t m_image_infos;
+
+	//! Find an opened file in the cache or open it.
+	/*!
+	 * \return nullptr if the file can't be opened.
+	 */
+	[[nodiscard]] cached_source_shared_ptr_t
+	find_or_open( std::string_view path );
+
+	[[nodiscard]] cached_source_shared_ptr_t
+	try_open( const std::string & relative_path ) const;
+
+	[[nodiscard]] bool
+	is_still_valid(
+		const std::string & relative_path,
+		cached_source_t & source ) const;
+};
+
+using source_files_shared_ptr_t = std::shared_ptr< source_files_t >;
+
+} /* namespace shrimp */
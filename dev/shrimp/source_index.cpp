@@ -0,0 +1,74 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief An index of source images inside the storage root directory.
+ */
+
+#include <shrimp/source_index.hpp>
+
+#include <mutex>
+
+namespace shrimp {
+
+//
+// source_index_t
+//
+[[nodiscard]] bool
+source_index_t::may_exist( std::string_view path ) const
+{
+	const auto first = path.find_first_not_of( '/' );
+	if( std::string_view::npos == first )
+		return false;
+	path.remove_prefix( first );
+
+	std::shared_lock< std::shared_mutex > lock{ m_lock };
+	return !m_ready || m_paths.find( path ) != m_paths.end();
+}
+
+void
+source_index_t::reset( std::set< std::string, std::less<> > paths )
+{
+	std::unique_lock< std::shared_mutex > lock{ m_lock };
+	m_paths.swap( paths );
+	m_ready = true;
+}
+
+void
+source_index_t::turn_off()
+{
+	std::unique_lock< std::shared_mutex > lock{ m_lock };
+	m_paths.clear();
+	m_ready = false;
+}
+
+void
+source_index_t::insert( std::string relative_path )
+{
+	std::unique_lock< std::shared_mutex > lock{ m_lock };
+	m_paths.insert( std::move(relative_path) );
+}
+
+void
+source_index_t::erase( std::string_view relative_path )
+{
+	std::unique_lock< std::shared_mutex > lock{ m_lock };
+	if( auto it = m_paths.find( relative_path ); it != m_paths.end() )
+		m_paths.erase( it );
+}
+
+void
+source_index_t::erase_directory( std::string_view relative_dir )
+{
+	std::string prefix{ relative_dir };
+	prefix += '/';
+
+	std::unique_lock< std::shared_mutex > lock{ m_lock };
+	auto it = m_paths.lower_bound( prefix );
+	while( it != m_paths.end() && 0 == it->compare( 0, prefix.size(), prefix ) )
+		it = m_paths.erase( it );
+}
+
+} /* namespace shrimp */
@@ -0,0 +1,77 @@
+/*
+ * Shrimp
+ */
+
+/*!
+ * \file
+ * \brief An index of source images inside the storage root directory.
+ */
+
+#pragma once
+
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+namespace shrimp {
+
+//
+// source_index_t
+//
+
+/*!
+ * \brief A set of relative paths of all source images.
+ *
+ * It allows to reject requests for missing source images without
+ * touching the file system.
+ *
+ * The index is filled and maintained by a_source_watcher_t agent. Until
+ * the index is filled every path is considered as possibly existing.
+ * The index also can be turned off if it can't be maintained properly.
+ *
+ * \note This class is thread-safe.
+ */
+class source_index_t
+{
+public:
+	//! Can a source image with that path exist?
+	/*!
+	 * \param path Path from URL (it starts with '/').
+	 *
+	 * \return false only if the index is ready and the path is unknown.
+	 */
+	[[nodiscard]] bool
+	may_exist( std::string_view path ) const;
+
+	//! Replace the content of the index and mark it as ready.
+	void
+	reset( std::set< std::string, std::less<> > paths );
+
+	//! Mark the index as not ready. All paths will be accepted.
+	void
+	turn_off();
+
+	//! Add a path to the index.
+	void
+	insert( std::string relative_path );
+
+	//! Remove a path from the index.
+	void
+	erase( std::string_view relative_path );
+
+	//! Remove all paths inside a directory from the index.
+	void
+	erase_directory( std::string_view relative_dir );
+
+private:
+	mutable std::shared_mutex m_lock;
+
+	//! Is the index filled and maintained?
+	bool m_ready{ false };
+
+	//! Relative paths of known source images.
+	std::set< std::string, std::less<> > m_paths;
+};
+
+} /* namespace shrimp */
@@ -35,6 +35,30 @@ at_least_uno( float value )
 	return std::max( std::size_t{1u}, static_cast< std::size_t >( value ) );
 }
 
+//! The side of the original image which is limited by resize parameters.
+[[nodiscard]] std::optional< std::size_t >
+limited_side(
+	Magick::Geometry original_size,
+	resize_params_t::mode_t mode ) noexcept
+{
+	switch( mode )
+	{
+		case resize_params_t::mode_t::width :
+			return original_size.width();
+
+		case resize_params_t::mode_t::height :
+			return original_size.height();
+
+		case resize_params_t::mode_t::longest :
+			return std::max( original_size.width(), original_size.height() );
+
+		case resize_params_t::mode_t::keep_original :
+		break;
+	}
+
+	return std::nullopt;
+}
+
 } /* anonymous namespace */
 
 
@@ -136,6 +160,78 @@ calculate_result_size(
 	return sz;
 }
 
+//
+// canonicalize_resize_params()
+//
+
+[[nodiscard]] resize_params_t
+canonicalize_resize_params(
+	Magick::Geometry original_size,
+	const resize_params_t & params,
+	bool allow_upscale )
+{
+	const auto side = limited_side( original_size, params.mode() );
+	if( !side )
+		return params;
+
+	const std::size_t value = params.value();
+	if( value == *side || ( !allow_upscale && value > *side ) )
+		return resize_params_t::make( std::nullopt, std::nullopt, std::nullopt );
+
+	return params;
+}
+
+//
+// quantize_size()
+//
+
+[[nodiscard]] std::uint32_t
+quantize_size(
+	std::uint32_t value,
+	std::uint32_t step_percent,
+	std::uint32_t max_value ) noexcept
+{
+	if( 0u == step_percent || value <= min_quantized_size || value > max_value )
+		return value;
+
+	std::uint64_t step = min_quantized_size;
+	while( step < value )
+		// Every step is rounded up and is at least one pixel.
+		step = std::max< std::uint64_t >(
+				step + 1u,
+				( step * ( 100u + step_percent ) + 99u ) / 100u );
+
+	return static_cast< std::uint32_t >(
+			std::min< std::uint64_t >( step, max_value ) );
+}
+
+//
+// quantize_resize_params()
+//
+
+[[nodiscard]] resize_params_t
+quantize_resize_params(
+	std::optional< Magick::Geometry > original_size,
+	const resize_params_t & params,
+	std::uint32_t step_percent )
+{
+	if( resize_params_t::mode_t::keep_original == params.mode() )
+		return params;
+
+	std::uint32_t max_value = resize_params_constraints_t::default_max_side;
+	if( original_size )
+	{
+		// A size which doesn't enlarge the image must not be rounded
+		// up to a size which does.
+		const auto side = *limited_side( *original_size, params.mode() );
+		if( params.value() <= side )
+			max_value = std::min< std::size_t >( max_value, side );
+	}
+
+	return params.with_value(
+			quantize_size( params.value(), step_percent, max_value ) );
+}
+
 } /* namespace transform */
 
 } /* namespace shrimp */
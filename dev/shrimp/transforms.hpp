@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <optional>
+#include <string_view>
 #include <cstdint>
 #include <tuple>
 
@@ -86,6 +87,19 @@ public :
 		return m_value;
 	}
 
+	//! Make parameters with the same mode but with another value.
+	/*!
+	 * \note Throws in keep_original mode.
+	 */
+	[[nodiscard]] resize_params_t
+	with_value( std::uint32_t value ) const
+	{
+		if( mode_t::keep_original == m_mode )
+			throw exception_t{ "value can't be set in keep_original mode" };
+
+		return { m_mode, value };
+	}
+
 	[[nodiscard]] bool
 	operator<( const resize_params_t & p ) const noexcept
 	{
@@ -141,22 +155,57 @@ class resize_request_key_t
 	std::string m_path;
 	image_format_t m_format;
 	resize_params_t m_params;
+	//! Quality for the encoder. Value 0 means the default quality.
+	std::uint32_t m_quality;
+	//! Is it a tiny placeholder for the image?
+	/*!
+	 * Placeholders have their own space of keys. A placeholder never
+	 * shares a key with a usual transformation even if they have
+	 * the same parameters.
+	 *
+	 * The cheapest decoding is used for placeholders and metadata
+	 * is removed from the result.
+	 */
+	bool m_placeholder;
 
 public:
 	resize_request_key_t(
 		std::string path,
 		image_format_t format,
-		resize_params_t params )
+		resize_params_t params,
+		std::uint32_t quality = 0u,
+		bool placeholder = false )
 		:	m_path{ std::move(path) }
 		,	m_format{ format }
 		,	m_params{ params }
+		,	m_quality{ quality }
+		,	m_placeholder{ placeholder }
 	{}
 
 	[[nodiscard]] bool
 	operator<(const resize_request_key_t & o ) const noexcept
 	{
-		return std::tie( m_path, m_format, m_params )
-				< std::tie( o.m_path, o.m_format, o.m_params );
+		return std::tie( m_path, m_format, m_params, m_quality, m_placeholder )
+				< std::tie( o.m_path, o.m_format, o.m_params, o.m_quality,
+						o.m_placeholder );
+	}
+
+	//! Comparison with a path only.
+	/*!
+	 * All keys for the same path are equivalent to that path.
+	 * It allows to find all keys for a path (or for paths with
+	 * some prefix) in ordered containers.
+	 */
+	[[nodiscard]] friend bool
+	operator<( const resize_request_key_t & k, std::string_view path ) noexcept
+	{
+		return std::string_view{ k.m_path } < path;
+	}
+
+	[[nodiscard]] friend bool
+	operator<( std::string_view path, const resize_request_key_t & k ) noexcept
+	{
+		return path < std::string_view{ k.m_path };
 	}
 
 	[[nodiscard]] const std::string &
@@ -176,6 +225,18 @@ public:
 	{
 		return m_params;
 	}
+
+	[[nodiscard]] std::uint32_t
+	quality() const noexcept
+	{
+		return m_quality;
+	}
+
+	[[nodiscard]] bool
+	placeholder() const noexcept
+	{
+		return m_placeholder;
+	}
 };
 
 inline std::ostream &
@@ -194,9 +255,15 @@ operator<<( std::ostream & to, const resize_request_key_t & what )
 		return r;
 	};
 
-	return (to << "{{path " << what.path() << "} {format: "
+	to << "{{path " << what.path() << "} {format: "
 			<< format_to_str(what.format()) << "} {params: "
-			<< what.params() << "}}");
+			<< what.params() << "}";
+	if( what.quality() )
+		to << " {quality: " << what.quality() << "}";
+	if( what.placeholder() )
+		to << " {placeholder}";
+
+	return (to << "}");
 }
 
 //
@@ -295,6 +362,76 @@ calculate_result_size(
 	//! Resize parameters.
 	const resize_params_t & params );
 
+//
+// canonicalize_resize_params()
+//
+
+//! Make canonical form of resize parameters for an image.
+/*!
+	Parameters which don't change the size of the image are replaced
+	by keep_original. If upscaling isn't allowed then parameters which
+	would enlarge the image are replaced by keep_original too.
+
+	Requests with canonical parameters share the same cache entry
+	and requests which don't change the image at all can be served
+	without a transformation.
+*/
+[[nodiscard]] resize_params_t
+canonicalize_resize_params(
+	//! The size of the original image.
+	Magick::Geometry original_size,
+	//! Resize parameters.
+	const resize_params_t & params,
+	//! Can the image be enlarged?
+	bool allow_upscale );
+
+//
+// quantize_size()
+//
+
+//! The least size which is changed by quantize_size().
+inline constexpr std::uint32_t min_quantized_size = 32u;
+
+//! Round a size up to the nearest value from the ladder of sizes.
+/*!
+	Values in the ladder start from min_quantized_size and every next
+	value is greater than the previous one by step_percent percents.
+
+	Values not greater than min_quantized_size and values greater than
+	max_value are returned as is. The result never exceeds max_value.
+	Zero step_percent turns quantization off.
+*/
+[[nodiscard]] std::uint32_t
+quantize_size(
+	//! Requested size.
+	std::uint32_t value,
+	//! Step of the ladder in percents.
+	std::uint32_t step_percent,
+	//! Max possible size.
+	std::uint32_t max_value ) noexcept;
+
+//
+// quantize_resize_params()
+//
+
+//! Round the requested size up to the ladder of sizes.
+/*!
+	Keep_original parameters are returned as is.
+
+	If the size of the original image is known then a size which
+	doesn't enlarge the image is never rounded up beyond the size of
+	the image. The result must be passed to canonicalize_resize_params()
+	after that, so requests for the same rendition share the same key.
+*/
+[[nodiscard]] resize_params_t
+quantize_resize_params(
+	//! The size of the original image if it is known.
+	std::optional< Magick::Geometry > original_size,
+	//! Resize parameters.
+	const resize_params_t & params,
+	//! Step of the ladder in percents.
+	std::uint32_t step_percent );
+
 } /* namespace transform */
 
 } /* namespace shrimp */
@@ -33,6 +33,39 @@ make_full_path( std::string_view root_dir, std::string_view path )
 	return full_path;
 }
 
+//! Check that a string starts with the specified prefix.
+[[nodiscard]] inline bool
+starts_with( std::string_view what, std::string_view prefix ) noexcept
+{
+	return what.size() >= prefix.size() &&
+			what.compare( 0, prefix.size(), prefix ) == 0;
+}
+
+//! Append a string to JSON text as a quoted and escaped value.
+inline void
+append_json_string( std::string & to, std::string_view what )
+{
+	to += '"';
+	for( const char ch : what )
+	{
+		switch( ch )
+		{
+			case '"': to += "\\\""; break;
+			case '\\': to += "\\\\"; break;
+			case '\n': to += "\\n"; break;
+			case '\r': to += "\\r"; break;
+			case '\t': to += "\\t"; break;
+			default:
+				if( static_cast< unsigned char >( ch ) < 0x20u )
+					to += fmt::format( "\\u{:04x}",
+							static_cast< unsigned int >( ch ) );
+				else
+					to += ch;
+		}
+	}
+	to += '"';
+}
+
 //! Make a value for HTTP-header field that have Date type.
 inline std::string
 make_date_http_field_value( std::time_t t )
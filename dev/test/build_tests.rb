@@ -5,4 +5,7 @@ MxxRu::Cpp::composite_target {
   required_prj "test/cache_alike_container/prj.ut.rb"
   required_prj "test/utils/prj.ut.rb"
   required_prj "test/transform/utils/prj.ut.rb"
+  required_prj "test/presets/prj.ut.rb"
+  required_prj "test/http_helpers/prj.ut.rb"
+  required_prj "test/image_route/prj.ut.rb"
 }
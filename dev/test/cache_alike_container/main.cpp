@@ -10,6 +10,7 @@
 #include <shrimp/key_multivalue_queue.hpp>
 
 #include <string>
+#include <string_view>
 
 using namespace std::string_literals;
 
@@ -155,6 +156,38 @@ TEST_CASE( "[single-value] several update_access_time with one item only" )
 	}
 }
 
+TEST_CASE( "[single-value] select_from by prefix" )
+{
+	using namespace shrimp;
+
+	using cache_t = cache_alike_container_t<std::string, std::string>;
+
+	cache_t cache;
+
+	cache.insert( "a/first", "F" );
+	cache.insert( "b/second", "S" );
+	cache.insert( "b/third", "T" );
+	cache.insert( "c/fourth", "F" );
+
+	const auto starts_with_b = []( const std::string & k ) {
+		return 0 == k.compare( 0, 2u, "b/" );
+	};
+
+	auto selected = cache.select_from( std::string_view{ "b/" }, starts_with_b );
+	REQUIRE( 2u == selected.size() );
+	REQUIRE( selected[ 0 ].key() == "b/second" );
+	REQUIRE( selected[ 1 ].key() == "b/third" );
+
+	for( auto & atoken : selected )
+		cache.erase( atoken );
+
+	REQUIRE( 2u == cache.size() );
+	REQUIRE( cache.lookup( "a/first" ) );
+	REQUIRE( cache.lookup( "c/fourth" ) );
+
+	REQUIRE( cache.select_from( std::string_view{ "b/" }, starts_with_b ).empty() );
+}
+
 TEST_CASE( "[multi-value] simple insert" )
 {
 	using namespace shrimp;
@@ -377,3 +410,30 @@ TEST_CASE( "[multi-value] find_first_for_key and extract_values_for_key" )
 	REQUIRE( 0u == cache.unique_keys() );
 }
 
+TEST_CASE( "[multi-value] select_from by prefix" )
+{
+	using namespace shrimp;
+
+	using cache_t = key_multivalue_queue_t<std::string, std::string>;
+
+	cache_t cache;
+
+	cache.insert( "a/first", "F1" );
+	cache.insert( "b/second", "S1" );
+	cache.insert( "b/second", "S2" );
+	cache.insert( "c/third", "T1" );
+
+	const auto starts_with_b = []( const std::string & k ) {
+		return 0 == k.compare( 0, 2u, "b/" );
+	};
+
+	auto selected = cache.select_from( std::string_view{ "b/" }, starts_with_b );
+	REQUIRE( 2u == selected.size() );
+	REQUIRE( selected[ 0 ].value() == "S1" );
+	REQUIRE( selected[ 1 ].value() == "S2" );
+
+	cache.erase( selected[ 0 ] );
+	REQUIRE( 3u == cache.unique_keys() );
+	cache.erase( selected[ 1 ] );
+	REQUIRE( 2u == cache.unique_keys() );
+}
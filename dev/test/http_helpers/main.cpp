@@ -0,0 +1,227 @@
+/*
+	Shrimp
+
+	Unit test for helpers for HTTP header fields.
+*/
+
+#include <catch/catch.hpp>
+
+#include <shrimp/http_helpers.hpp>
+
+using namespace std::chrono;
+
+TEST_CASE( "valid dates" , "[parse_http_date]" )
+{
+	using namespace shrimp;
+
+	const auto d = parse_http_date( "Sun, 06 Nov 1994 08:49:37 GMT" );
+	REQUIRE( d );
+	REQUIRE( 784111777 == system_clock::to_time_t( *d ) );
+
+	const auto epoch = parse_http_date( "Thu, 01 Jan 1970 00:00:00 GMT" );
+	REQUIRE( epoch );
+	REQUIRE( 0 == system_clock::to_time_t( *epoch ) );
+}
+
+TEST_CASE( "invalid dates" , "[parse_http_date]" )
+{
+	using namespace shrimp;
+
+	REQUIRE( !parse_http_date( "" ) );
+	REQUIRE( !parse_http_date( "06 Nov 1994 08:49:37 GMT" ) );
+	REQUIRE( !parse_http_date( "Sun, 06 Nov 1994 08:49:37" ) );
+	REQUIRE( !parse_http_date( "Sun, 06 Nov 1994 08:49:37 UTC" ) );
+	REQUIRE( !parse_http_date( "Sun, 6 Nov 1994 08:49:37 GMT" ) );
+	REQUIRE( !parse_http_date( "Sun, 06 Noe 1994 08:49:37 GMT" ) );
+	REQUIRE( !parse_http_date( "Sun, 06 Nov 1994 24:49:37 GMT" ) );
+	REQUIRE( !parse_http_date( "Sunday, 06-Nov-94 08:49:37 GMT" ) );
+}
+
+TEST_CASE( "formatting of dates" , "[format_http_date]" )
+{
+	using namespace shrimp;
+
+	const auto d = system_clock::from_time_t( 784111777 ) + milliseconds{ 500 };
+	REQUIRE( "Sun, 06 Nov 1994 08:49:37 GMT" == format_http_date( d ) );
+	REQUIRE( system_clock::from_time_t( 784111777 ) ==
+			*parse_http_date( format_http_date( d ) ) );
+
+	// The second can change between the calls.
+	const auto before = format_http_date( system_clock::now() );
+	const auto current = current_http_date();
+	const auto after = format_http_date( system_clock::now() );
+	REQUIRE( ( before == current || after == current ) );
+}
+
+TEST_CASE( "etag lists" , "[etag_list_matches]" )
+{
+	using namespace shrimp;
+
+	const auto etag = R"("0123456789abcdef")";
+
+	REQUIRE( etag_list_matches( "*", etag ) );
+	REQUIRE( etag_list_matches( R"("0123456789abcdef")", etag ) );
+	REQUIRE( etag_list_matches( R"(W/"0123456789abcdef")", etag ) );
+	REQUIRE( etag_list_matches( R"("a", "0123456789abcdef")", etag ) );
+	REQUIRE( etag_list_matches( R"("a" ,"0123456789abcdef" ,"b")", etag ) );
+
+	REQUIRE( !etag_list_matches( "", etag ) );
+	REQUIRE( !etag_list_matches( R"("a", "b")", etag ) );
+	REQUIRE( !etag_list_matches( R"("0123456789abcde")", etag ) );
+	REQUIRE( !etag_list_matches( "0123456789abcdef", etag ) );
+}
+
+TEST_CASE( "conditional requests" , "[is_not_modified]" )
+{
+	using namespace shrimp;
+
+	const auto etag = R"("0123456789abcdef")";
+	const auto last_modified = system_clock::from_time_t( 784111777 ) +
+			milliseconds{ 500 };
+	const auto same_date = "Sun, 06 Nov 1994 08:49:37 GMT";
+	const auto earlier_date = "Sun, 06 Nov 1994 08:49:36 GMT";
+
+	// No conditional fields.
+	REQUIRE( !is_not_modified( std::nullopt, std::nullopt, etag, last_modified ) );
+
+	// If-Modified-Since only.
+	REQUIRE( is_not_modified( std::nullopt, same_date, etag, last_modified ) );
+	REQUIRE( !is_not_modified( std::nullopt, earlier_date, etag, last_modified ) );
+	REQUIRE( !is_not_modified( std::nullopt, "yesterday", etag, last_modified ) );
+
+	// If-None-Match has the priority.
+	REQUIRE( is_not_modified( etag, earlier_date, etag, last_modified ) );
+	REQUIRE( !is_not_modified( R"("other")", same_date, etag, last_modified ) );
+}
+
+TEST_CASE( "single ranges" , "[parse_byte_ranges]" )
+{
+	using namespace shrimp;
+	using ranges_t = std::vector< byte_range_t >;
+
+	REQUIRE( ranges_t{ { 0, 500 } } == *parse_byte_ranges( "bytes=0-499", 1000, 16 ) );
+	REQUIRE( ranges_t{ { 500, 500 } } == *parse_byte_ranges( "bytes=500-", 1000, 16 ) );
+	REQUIRE( ranges_t{ { 900, 100 } } == *parse_byte_ranges( "bytes=-100", 1000, 16 ) );
+
+	// Truncated ranges.
+	REQUIRE( ranges_t{ { 900, 100 } } == *parse_byte_ranges( "bytes=900-5000", 1000, 16 ) );
+	REQUIRE( ranges_t{ { 0, 1000 } } == *parse_byte_ranges( "bytes=-5000", 1000, 16 ) );
+
+	// Unsatisfiable ranges.
+	REQUIRE( parse_byte_ranges( "bytes=1000-", 1000, 16 )->empty() );
+	REQUIRE( parse_byte_ranges( "bytes=-0", 1000, 16 )->empty() );
+	REQUIRE( parse_byte_ranges( "bytes=0-", 0, 16 )->empty() );
+}
+
+TEST_CASE( "multiple ranges" , "[parse_byte_ranges]" )
+{
+	using namespace shrimp;
+	using ranges_t = std::vector< byte_range_t >;
+
+	REQUIRE( ranges_t{ { 0, 10 }, { 20, 10 }, { 990, 10 } } ==
+			*parse_byte_ranges( "bytes=0-9, 20-29,,-10", 1000, 16 ) );
+
+	// Unsatisfiable ranges are dropped.
+	REQUIRE( ranges_t{ { 0, 10 } } ==
+			*parse_byte_ranges( "bytes=0-9,2000-3000", 1000, 16 ) );
+
+	// Too many ranges.
+	REQUIRE( !parse_byte_ranges( "bytes=0-1,2-3,4-5", 1000, 2 ) );
+}
+
+TEST_CASE( "invalid ranges" , "[parse_byte_ranges]" )
+{
+	using namespace shrimp;
+
+	REQUIRE( !parse_byte_ranges( "", 1000, 16 ) );
+	REQUIRE( !parse_byte_ranges( "bytes=", 1000, 16 ) );
+	REQUIRE( !parse_byte_ranges( "items=0-9", 1000, 16 ) );
+	REQUIRE( !parse_byte_ranges( "bytes=9-0", 1000, 16 ) );
+	REQUIRE( !parse_byte_ranges( "bytes=a-9", 1000, 16 ) );
+	REQUIRE( !parse_byte_ranges( "bytes=10", 1000, 16 ) );
+	REQUIRE( !parse_byte_ranges( "bytes=-", 1000, 16 ) );
+	REQUIRE( !parse_byte_ranges( "bytes=0-9,x", 1000, 16 ) );
+}
+
+TEST_CASE( "if-range" , "[if_range_matches]" )
+{
+	using namespace shrimp;
+
+	const auto etag = R"("0123456789abcdef")";
+	const auto last_modified = system_clock::from_time_t( 784111777 ) +
+			milliseconds{ 500 };
+
+	REQUIRE( if_range_matches( etag, etag, last_modified ) );
+	REQUIRE( !if_range_matches( R"("other")", etag, last_modified ) );
+	REQUIRE( !if_range_matches( R"(W/"0123456789abcdef")", etag, last_modified ) );
+
+	REQUIRE( if_range_matches(
+			"Sun, 06 Nov 1994 08:49:37 GMT", etag, last_modified ) );
+	REQUIRE( !if_range_matches(
+			"Sun, 06 Nov 1994 08:49:36 GMT", etag, last_modified ) );
+	REQUIRE( !if_range_matches( "garbage", etag, last_modified ) );
+}
+
+TEST_CASE( "content range" , "[make_content_range_value]" )
+{
+	using namespace shrimp;
+
+	REQUIRE( "bytes 0-499/1000" == make_content_range_value( { 0, 500 }, 1000 ) );
+	REQUIRE( "bytes 999-999/1000" == make_content_range_value( { 999, 1 }, 1000 ) );
+}
+
+TEST_CASE( "cache control" , "[make_cache_control_value]" )
+{
+	using namespace shrimp;
+
+	cache_control_policy_t policy;
+	REQUIRE( make_cache_control_value( policy, false ).empty() );
+	REQUIRE( "public, max-age=31536000, immutable" ==
+			make_cache_control_value( policy, true ) );
+
+	policy.m_max_age = 3600u;
+	REQUIRE( "public, max-age=3600" == make_cache_control_value( policy, false ) );
+
+	policy.m_s_maxage = 86400u;
+	policy.m_stale_while_revalidate = 60u;
+	REQUIRE( "public, max-age=3600, s-maxage=86400, stale-while-revalidate=60" ==
+			make_cache_control_value( policy, false ) );
+	REQUIRE( "public, max-age=31536000, immutable" ==
+			make_cache_control_value( policy, true ) );
+}
+
+TEST_CASE( "accept" , "[accepts_media_type]" )
+{
+	using namespace shrimp;
+
+	REQUIRE( accepts_media_type(
+			"image/avif,image/webp,image/apng,image/*,*/*;q=0.8",
+			"image/webp" ) );
+	REQUIRE( accepts_media_type( "image/png, image/webp;q=0.5", "image/webp" ) );
+
+	REQUIRE( !accepts_media_type( "", "image/webp" ) );
+	REQUIRE( !accepts_media_type( "image/png,image/*;q=0.8", "image/webp" ) );
+	REQUIRE( !accepts_media_type( "*/*", "image/webp" ) );
+	REQUIRE( !accepts_media_type( "image/webp;q=0", "image/webp" ) );
+	REQUIRE( !accepts_media_type( "image/webp; q=0.000", "image/webp" ) );
+	REQUIRE( !accepts_media_type( "image/webpx", "image/webp" ) );
+}
+
+TEST_CASE( "client hints" , "[width_from_client_hints]" )
+{
+	using namespace shrimp;
+
+	// Width has the priority.
+	REQUIRE( 640u == width_from_client_hints( "640", "2", "1000" ) );
+	REQUIRE( 2000u == width_from_client_hints( std::nullopt, "2", "1000" ) );
+	REQUIRE( 1000u == width_from_client_hints( std::nullopt, std::nullopt, "1000" ) );
+	REQUIRE( 1500u == width_from_client_hints( std::nullopt, "1.5", "1000" ) );
+	REQUIRE( 1313u == width_from_client_hints( std::nullopt, "2.625", "500" ) );
+
+	// Invalid hints.
+	REQUIRE( !width_from_client_hints( std::nullopt, std::nullopt, std::nullopt ) );
+	REQUIRE( !width_from_client_hints( std::nullopt, "2", std::nullopt ) );
+	REQUIRE( !width_from_client_hints( "0", std::nullopt, std::nullopt ) );
+	REQUIRE( !width_from_client_hints( "abc", std::nullopt, "0" ) );
+	REQUIRE( 800u == width_from_client_hints( "abc", "x", "800" ) );
+}
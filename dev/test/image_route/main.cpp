@@ -0,0 +1,84 @@
+/*
+	Shrimp
+
+	Unit test for matching of requests for images.
+*/
+
+#include <catch/catch.hpp>
+
+#include <shrimp/image_route.hpp>
+
+using namespace std::literals;
+
+TEST_CASE( "image paths" , "[try_match_image_route]" )
+{
+	using namespace shrimp;
+
+	const auto r = try_match_image_route( "/dir/image.jpeg" );
+	REQUIRE( r );
+	REQUIRE( "dir/image" == r->m_path );
+	REQUIRE( "jpeg" == r->m_ext );
+
+	const auto r2 = try_match_image_route( "/a.b.png" );
+	REQUIRE( r2 );
+	REQUIRE( "a.b" == r2->m_path );
+	REQUIRE( "png" == r2->m_ext );
+
+	// The path can be empty as in the express route.
+	const auto r3 = try_match_image_route( "/.gif" );
+	REQUIRE( r3 );
+	REQUIRE( r3->m_path.empty() );
+	REQUIRE( "gif" == r3->m_ext );
+
+	// The shortest extension wins.
+	const auto r4 = try_match_image_route( "/a.x.abc" );
+	REQUIRE( r4 );
+	REQUIRE( "a.x" == r4->m_path );
+	REQUIRE( "abc" == r4->m_ext );
+}
+
+TEST_CASE( "not image paths" , "[try_match_image_route]" )
+{
+	using namespace shrimp;
+
+	REQUIRE( !try_match_image_route( "" ) );
+	REQUIRE( !try_match_image_route( "/" ) );
+	REQUIRE( !try_match_image_route( "image.jpg" ) );
+	REQUIRE( !try_match_image_route( "/image" ) );
+	REQUIRE( !try_match_image_route( "/image.jp" ) );
+	REQUIRE( !try_match_image_route( "/image.jpegx" ) );
+	REQUIRE( !try_match_image_route( "/cache" ) );
+	REQUIRE( !try_match_image_route( "/cache/prewarm/12" ) );
+}
+
+TEST_CASE( "query strings" , "[parse_image_query]" )
+{
+	using namespace shrimp;
+
+	const auto empty = parse_image_query( "", "v" );
+	REQUIRE( empty );
+	REQUIRE( 0u == empty->m_params_count );
+	REQUIRE( !empty->m_versioned );
+
+	const auto q = parse_image_query(
+			"op=resize&width=100&&max=300&target-format=webp&v=12&x=1&width=200",
+			"v" );
+	REQUIRE( q );
+	REQUIRE( "resize"sv == q->m_op );
+	REQUIRE( "100"sv == q->m_width );
+	REQUIRE( !q->m_height );
+	REQUIRE( "300"sv == q->m_max );
+	REQUIRE( "webp"sv == q->m_target_format );
+	REQUIRE( !q->m_preset );
+	REQUIRE( q->m_versioned );
+	REQUIRE( 7u == q->m_params_count );
+
+	const auto p = parse_image_query( "preset=thumb&v=", "" );
+	REQUIRE( p );
+	REQUIRE( "thumb"sv == p->m_preset );
+	REQUIRE( !p->m_versioned );
+	REQUIRE( 2u == p->m_params_count );
+
+	REQUIRE( !parse_image_query( "op", "v" ) );
+	REQUIRE( !parse_image_query( "width=1&=2", "v" ) );
+}
@@ -0,0 +1,4 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch/catch.hpp>
+
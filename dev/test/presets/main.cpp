@@ -0,0 +1,106 @@
+/*
+	Shrimp
+
+	Unit test for presets.
+*/
+
+// Fix for debug build:  ‘__assert_fail’ was not declared in this scope
+// somewhere in fmt.
+#include <cassert>
+
+#include <catch/catch.hpp>
+
+#include <shrimp/presets.hpp>
+
+TEST_CASE( "minimal preset" , "[parse_preset]" )
+{
+	using namespace shrimp;
+	using mode_t = transform::resize_params_t::mode_t;
+
+	const auto [name, preset] = parse_preset( "thumb=width:128" );
+
+	REQUIRE( "thumb" == name );
+	REQUIRE( mode_t::width == preset.m_params.mode() );
+	REQUIRE( 128u == preset.m_params.value() );
+	REQUIRE( !preset.m_format );
+	REQUIRE( 0u == preset.m_quality );
+	REQUIRE( !preset.m_pinned );
+}
+
+TEST_CASE( "preset with all parameters" , "[parse_preset]" )
+{
+	using namespace shrimp;
+	using mode_t = transform::resize_params_t::mode_t;
+
+	const auto [name, preset] = parse_preset(
+			"hero=max:1920,format=webp,quality=75,pinned" );
+
+	REQUIRE( "hero" == name );
+	REQUIRE( mode_t::longest == preset.m_params.mode() );
+	REQUIRE( 1920u == preset.m_params.value() );
+	REQUIRE( preset.m_format );
+	REQUIRE( image_format_t::webp == *preset.m_format );
+	REQUIRE( 75u == preset.m_quality );
+	REQUIRE( preset.m_pinned );
+
+	const auto [name2, preset2] = parse_preset( "h=height:64,pinned" );
+	REQUIRE( "h" == name2 );
+	REQUIRE( mode_t::height == preset2.m_params.mode() );
+	REQUIRE( 64u == preset2.m_params.value() );
+	REQUIRE( preset2.m_pinned );
+	REQUIRE( preset2.m_cache_control.empty() );
+}
+
+TEST_CASE( "preset with cache control" , "[parse_preset]" )
+{
+	using namespace shrimp;
+
+	const auto [name, preset] = parse_preset(
+			"thumb=width:128,max-age=3600,s-maxage=86400,"
+			"stale-while-revalidate=60" );
+
+	REQUIRE( "thumb" == name );
+	REQUIRE( 3600u == preset.m_cache_control.m_max_age );
+	REQUIRE( 86400u == preset.m_cache_control.m_s_maxage );
+	REQUIRE( 60u == preset.m_cache_control.m_stale_while_revalidate );
+
+	REQUIRE_THROWS( parse_preset( "thumb=width:128,max-age=" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:128,max-age=-1" ) );
+}
+
+TEST_CASE( "invalid presets" , "[parse_preset]" )
+{
+	using namespace shrimp;
+
+	REQUIRE_THROWS( parse_preset( "" ) );
+	REQUIRE_THROWS( parse_preset( "thumb" ) );
+	REQUIRE_THROWS( parse_preset( "=width:128" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:abc" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:0" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:100000" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=side:128" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:128,format=bmp" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:128,quality=0" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:128,quality=101" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:128,pinned=yes" ) );
+	REQUIRE_THROWS( parse_preset( "thumb=width:128,unknown" ) );
+}
+
+TEST_CASE( "cache control policies" , "[parse_cache_control_policy]" )
+{
+	using namespace shrimp;
+
+	REQUIRE( parse_cache_control_policy( "" ).empty() );
+
+	const auto policy = parse_cache_control_policy( "max-age=600,s-maxage=3600" );
+	REQUIRE( 600u == policy.m_max_age );
+	REQUIRE( 3600u == policy.m_s_maxage );
+	REQUIRE( !policy.m_stale_while_revalidate );
+
+	REQUIRE_THROWS( parse_cache_control_policy( "max-age" ) );
+	REQUIRE_THROWS( parse_cache_control_policy( "max-age=abc" ) );
+	REQUIRE_THROWS( parse_cache_control_policy( "no-cache=1" ) );
+}
@@ -218,3 +218,167 @@ TEST_CASE( "calculate_result_size resize" , "[calculate_result_size][resize]" )
 		REQUIRE( 1 == result_size.height() ); // At least 1.
 	}
 }
+
+TEST_CASE( "quantize_size" , "[quantize_size]" )
+{
+	using namespace shrimp::transform;
+
+	// Quantization is turned off.
+	REQUIRE( 317 == quantize_size( 317, 0, 5000 ) );
+
+	// Small and too big values are not changed.
+	REQUIRE( 1 == quantize_size( 1, 10, 5000 ) );
+	REQUIRE( min_quantized_size ==
+			quantize_size( min_quantized_size, 10, 5000 ) );
+	REQUIRE( 6000 == quantize_size( 6000, 10, 5000 ) );
+
+	// Close values are merged.
+	const auto q = quantize_size( 322, 10, 5000 );
+	REQUIRE( q >= 322 );
+	REQUIRE( q == quantize_size( 325, 10, 5000 ) );
+	REQUIRE( q == quantize_size( 330, 10, 5000 ) );
+	REQUIRE( q == quantize_size( q, 10, 5000 ) );
+	REQUIRE( q < quantize_size( q + 1, 10, 5000 ) );
+
+	// Result is never less than the value and not too far from it.
+	for( std::uint32_t v = 1; v <= 5000; ++v )
+	{
+		const auto r = quantize_size( v, 10, 5000 );
+		REQUIRE( r >= v );
+		REQUIRE( r <= 5000 );
+		REQUIRE( r <= v + v / 10 + 1 );
+	}
+
+	// Max value is used instead of values from the ladder above it.
+	REQUIRE( 5000 == quantize_size( 4999, 10, 5000 ) );
+}
+
+TEST_CASE( "canonicalize_resize_params" , "[canonicalize_resize_params]" )
+{
+	using namespace shrimp::transform;
+	using mode_t = resize_params_t::mode_t;
+
+	const Magick::Geometry original{ 640, 480 };
+
+	SECTION( "keep_original" )
+	{
+		const auto p = canonicalize_resize_params(
+				original,
+				resize_params_t::make( std::nullopt, std::nullopt, std::nullopt ),
+				true );
+		REQUIRE( mode_t::keep_original == p.mode() );
+	}
+
+	SECTION( "the same size" )
+	{
+		for( const auto & params : {
+				resize_params_t::make( 640, std::nullopt, std::nullopt ),
+				resize_params_t::make( std::nullopt, 480, std::nullopt ),
+				resize_params_t::make( std::nullopt, std::nullopt, 640 ) } )
+		{
+			REQUIRE( mode_t::keep_original ==
+					canonicalize_resize_params( original, params, true ).mode() );
+			REQUIRE( mode_t::keep_original ==
+					canonicalize_resize_params( original, params, false ).mode() );
+		}
+	}
+
+	SECTION( "downscale" )
+	{
+		const auto p = canonicalize_resize_params(
+				original,
+				resize_params_t::make( std::nullopt, 240, std::nullopt ),
+				false );
+		REQUIRE( mode_t::height == p.mode() );
+		REQUIRE( 240 == p.value() );
+	}
+
+	SECTION( "upscale" )
+	{
+		const auto params = resize_params_t::make(
+				std::nullopt, std::nullopt, 1024 );
+
+		const auto allowed = canonicalize_resize_params( original, params, true );
+		REQUIRE( mode_t::longest == allowed.mode() );
+		REQUIRE( 1024 == allowed.value() );
+
+		REQUIRE( mode_t::keep_original ==
+				canonicalize_resize_params( original, params, false ).mode() );
+
+		// Height is the longest side of a portrait image.
+		REQUIRE( mode_t::keep_original ==
+				canonicalize_resize_params(
+						Magick::Geometry{ 480, 640 },
+						resize_params_t::make( std::nullopt, std::nullopt, 640 ),
+						true ).mode() );
+	}
+}
+
+TEST_CASE( "quantize_resize_params" , "[quantize_resize_params]" )
+{
+	using namespace shrimp::transform;
+	using mode_t = resize_params_t::mode_t;
+
+	const Magick::Geometry original{ 300, 200 };
+
+	SECTION( "keep_original" )
+	{
+		const auto p = quantize_resize_params(
+				original,
+				resize_params_t::make( std::nullopt, std::nullopt, std::nullopt ),
+				10 );
+		REQUIRE( mode_t::keep_original == p.mode() );
+	}
+
+	SECTION( "downscale" )
+	{
+		const auto p = canonicalize_resize_params(
+				original,
+				quantize_resize_params(
+						original,
+						resize_params_t::make( 200, std::nullopt, std::nullopt ),
+						10 ),
+				false );
+		REQUIRE( mode_t::width == p.mode() );
+		REQUIRE( quantize_size( 200, 10, 5000 ) == p.value() );
+	}
+
+	SECTION( "quantized size isn't greater than the image" )
+	{
+		// This size is rounded up beyond the width of the image.
+		REQUIRE( quantize_size( 290, 10, 5000 ) > original.width() );
+
+		const auto params = resize_params_t::make(
+				290, std::nullopt, std::nullopt );
+
+		const auto quantized = quantize_resize_params( original, params, 10 );
+		REQUIRE( mode_t::width == quantized.mode() );
+		REQUIRE( original.width() == quantized.value() );
+
+		// So it is the same rendition as the original image.
+		for( const bool allow_upscale : { true, false } )
+			REQUIRE( mode_t::keep_original ==
+					canonicalize_resize_params(
+							original, quantized, allow_upscale ).mode() );
+	}
+
+	SECTION( "upscale" )
+	{
+		const auto p = quantize_resize_params(
+				original,
+				resize_params_t::make( std::nullopt, std::nullopt, 322 ),
+				10 );
+		REQUIRE( mode_t::longest == p.mode() );
+		REQUIRE( quantize_size( 322, 10, 5000 ) == p.value() );
+	}
+
+	SECTION( "unknown size of the image" )
+	{
+		const auto p = quantize_resize_params(
+				std::nullopt,
+				resize_params_t::make( std::nullopt, 290, std::nullopt ),
+				10 );
+		REQUIRE( mode_t::height == p.mode() );
+		REQUIRE( quantize_size( 290, 10, 5000 ) == p.value() );
+	}
+}
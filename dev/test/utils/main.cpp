@@ -17,3 +17,16 @@ TEST_CASE( "make_full_path" , "[make_full_path]" )
 							"~/media/pics/summer2018/logo.jpeg");
 }
 
+
+TEST_CASE( "append_json_string" , "[append_json_string]" )
+{
+	using namespace shrimp;
+
+	std::string json{ "{\"path\":" };
+	append_json_string( json, "/dir/a \"b\".jpg" );
+	REQUIRE( json == "{\"path\":\"/dir/a \\\"b\\\".jpg\"" );
+
+	json.clear();
+	append_json_string( json, "a\\b\n\x01" );
+	REQUIRE( json == "\"a\\\\b\\n\\u0001\"" );
+}
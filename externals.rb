@@ -52,3 +52,9 @@ MxxRu::arch_externals :catch do |e|
 
   e.map_file 'single_include/catch.hpp' => 'dev/catch/*'
 end
+
+MxxRu::arch_externals :xxhash do |e|
+  e.url 'https://github.com/Cyan4973/xxHash/archive/v0.8.2.tar.gz'
+
+  e.map_file 'xxhash.h' => 'dev/xxhash/*'
+end